@@ -0,0 +1,36 @@
+#!/bin/sh
+# Headless build for Linux/macOS: the processing path, tools and tests, no windows, no capture API
+
+echo Building headless pipeline
+echo ==========================
+
+cd "$(dirname "$0")"
+CXX=${CXX:-g++}
+FLAGS="-std=c++17 -O2 -I.. -pthread"
+
+SOURCES="../source/frame_converter.cpp ../source/frame_pool.cpp ../source/file_frame_source.cpp ../source/synthetic_frame_source.cpp"
+CORE="../loader.cpp ../parser.cpp ../classifier/*.cpp ../kernels/*.cpp ../runtime/*.cpp $SOURCES"
+
+$CXX $FLAGS ../tools/headless_pipeline.cpp $CORE -o headless_pipeline || { echo Build failed!; exit 1; }
+$CXX $FLAGS ../tools/calibrate_cascade.cpp ../tools/sample_set.cpp $CORE -o calibrate_cascade || { echo Build failed!; exit 1; }
+$CXX $FLAGS ../tools/prune_cascade.cpp ../tools/sample_set.cpp $CORE -o prune_cascade || { echo Build failed!; exit 1; }
+
+for test in ../tests/*_test.cpp; do
+    $CXX $FLAGS "$test" $CORE -o "$(basename "$test" .cpp)" || { echo Build failed!; exit 1; }
+done
+
+echo Build successful!
+
+# Each test prints its own summary line last; the full output only on failure
+echo Running tests
+failed=0
+for test in ../tests/*_test.cpp; do
+    name=$(basename "$test" .cpp)
+    if output=$(./"$name" 2>&1); then
+        echo "$output" | tail -n 1
+    else
+        echo "$output"
+        failed=1
+    fi
+done
+[ $failed -eq 0 ] || { echo Tests failed!; exit 1; }
@@ -0,0 +1,28 @@
+@echo off
+
+echo Building tools with Visual Studio 2022
+echo ======================================
+
+call "C:\Program Files\Microsoft Visual Studio\2022\Community\VC\Auxiliary\Build\vcvars64.bat"
+
+set SOURCES=..\source\frame_converter.cpp ..\source\frame_pool.cpp ..\source\file_frame_source.cpp ..\source\synthetic_frame_source.cpp
+set COMMON=..\loader.cpp ..\parser.cpp ..\classifier\*.cpp ..\kernels\*.cpp ..\runtime\*.cpp %SOURCES% ..\tools\sample_set.cpp
+
+cl /EHsc /O2 /std:c++17 /DUNICODE /D_UNICODE /I".." ..\tools\calibrate_cascade.cpp %COMMON% /link /out:calibrate_cascade.exe
+if %errorlevel% neq 0 goto failed
+
+cl /EHsc /O2 /std:c++17 /DUNICODE /D_UNICODE /I".." ..\tools\prune_cascade.cpp %COMMON% /link /out:prune_cascade.exe
+if %errorlevel% neq 0 goto failed
+
+set CAPTURE=..\source\mf_frame_source.cpp ..\source\source_reader.cpp ..\device\device_setter.cpp
+
+cl /EHsc /O2 /std:c++17 /DUNICODE /D_UNICODE /I".." ..\tools\headless_pipeline.cpp %COMMON% %CAPTURE%^
+   /link mf.lib mfplat.lib mfreadwrite.lib mfuuid.lib ole32.lib /out:headless_pipeline.exe
+if %errorlevel% neq 0 goto failed
+
+echo Tools built!
+exit /b 0
+
+:failed
+echo Build failed!
+pause
@@ -5,6 +5,7 @@
 #include <fstream>
 #include "rect.h"
 #include "feature.h"
+#include "integral_image.h"
 
 class WeakClassifier {
     public:
@@ -22,7 +23,7 @@ class WeakClassifier {
         weight(w) {}
 
         bool classify(
-            const std::vector<std::vector<float>>& integral,
+            const IntegralImage& integral,
             int x,
             int y,
             float scale
@@ -33,13 +34,24 @@ class StrongClassifier {
     public:
         std::vector<WeakClassifier> weakClassifiers;
         float threshold;
+        std::vector<float> rejectionTrace;
 
         bool classify(
-            const std::vector<std::vector<float>>& integral,
+            const IntegralImage& integral,
             int x,
             int y,
             float scale
         ) const;
+        float evaluate(
+            const IntegralImage& integral,
+            int x,
+            int y,
+            float scale,
+            std::vector<float>* partialSums = nullptr
+        ) const;
+        bool hasRejectionTrace() const {
+            return rejectionTrace.size() == weakClassifiers.size();
+        }
         void addClassifier(const WeakClassifier& wc) {
             weakClassifiers.push_back(wc);
         }
@@ -0,0 +1,276 @@
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include "detection_grouper.h"
+
+int DetectionGrouper::find(int i) {
+    while(parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+void DetectionGrouper::unite(int a, int b) {
+    a = find(a);
+    b = find(b);
+    if(a == b) return;
+    if(a < b) parent[b] = a;
+    else parent[a] = b;
+    unions++;
+}
+
+/*
+** Buckets
+*/
+int DetectionGrouper::scaleBucket(int size) const {
+    float logStep = std::log(1.0f + eps);
+    return static_cast<int>(std::floor(std::log(static_cast<float>((std::max)(size, 1))) / logStep));
+}
+
+float DetectionGrouper::cellSize(int scaleBucket) const {
+    float logStep = std::log(1.0f + eps);
+    float size = std::exp((scaleBucket + 1) * logStep);
+    return (std::max)(1.0f, eps * size);
+}
+
+long long DetectionGrouper::key(int gx, int gy, int gs) const {
+    return 
+        (static_cast<long long>(gs & 0xFFFF) << 40) ^
+        (static_cast<long long>(gy & 0xFFFFF) << 20) ^
+        static_cast<long long>(gx & 0xFFFFF);
+}
+
+bool DetectionGrouper::similar(const Rect& a, const Rect& b) const {
+    float delta = eps * ((std::min)(a.width, b.width) + (std::min)(a.height, b.height)) * 0.5f;
+    return 
+        std::abs(a.x - b.x) <= delta &&
+        std::abs(a.y - b.y) <= delta &&
+        std::abs(a.x + a.width - b.x - b.width) <= delta &&
+        std::abs(a.y + a.height - b.y - b.height) <= delta;
+}
+
+namespace {
+    void widen(int* range, int value, bool first) {
+        if(first || value < range[0]) range[0] = value;
+        if(first || value > range[1]) range[1] = value;
+    }
+
+    int gap(const int* a, const int* b) {
+        return (std::max)(0, (std::max)(b[0] - a[1], a[0] - b[1]));
+    }
+}
+
+// False only when no member of one can be similar() to any member of the other
+bool DetectionGrouper::mayBeSimilar(const Bucket& a, const Bucket& b) const {
+    float delta = eps * (std::max)(a.extent, b.extent);
+    return
+        gap(a.left, b.left) <= delta &&
+        gap(a.top, b.top) <= delta &&
+        gap(a.right, b.right) <= delta &&
+        gap(a.bottom, b.bottom) <= delta;
+}
+
+// The same for a single rect, before it is compared member by member
+bool DetectionGrouper::mayBeSimilar(const Rect& r, const Bucket& b) const {
+    int left[2] = { r.x, r.x };
+    int top[2] = { r.y, r.y };
+    int right[2] = { r.x + r.width, r.x + r.width };
+    int bottom[2] = { r.y + r.height, r.y + r.height };
+    float delta = eps * (std::max)((r.width + r.height) * 0.5f, b.extent);
+    return
+        gap(left, b.left) <= delta &&
+        gap(top, b.top) <= delta &&
+        gap(right, b.right) <= delta &&
+        gap(bottom, b.bottom) <= delta;
+}
+
+// Once every member shares a root it stays that way; a no holds until the next union
+bool DetectionGrouper::isOneSet(Bucket& b) {
+    if(b.oneSet) return true;
+    if(b.checkedAt == unions) return false;
+    int root = find(b.members[0]);
+    for(int i : b.members) {
+        if(find(i) != root) {
+            b.checkedAt = unions;
+            return false;
+        }
+    }
+    b.oneSet = true;
+    return true;
+}
+
+/*
+** Every pair between two cells that is not yet in one set. Once a hit
+** is joined to a cell that is a single set it is joined to all of it,
+** and two single sets are merged whole by their first similar pair.
+*/
+void DetectionGrouper::joinCells(
+    const std::vector<Rect>& candidates,
+    Bucket& from,
+    Bucket& to
+) {
+    bool toOneSet = isOneSet(to);
+    bool bothOneSet = toOneSet && isOneSet(from);
+    if(bothOneSet && find(from.members[0]) == find(to.members[0])) return;
+
+    for(int i : from.members) {
+        const Rect& r = candidates[i];
+        if(!mayBeSimilar(r, to)) continue;
+        for(int j : to.members) {
+            if(find(i) == find(j)) {
+                if(toOneSet) break;
+                continue;
+            }
+            if(!similar(r, candidates[j])) continue;
+            unite(i, j);
+            if(bothOneSet) return;
+            if(toOneSet) break;
+        }
+    }
+}
+
+/*
+** Group
+*/
+std::vector<Rect> DetectionGrouper::group(const std::vector<Rect>& candidates) {
+    std::vector<Rect> res;
+    if(candidates.empty()) return res;
+
+    int n = static_cast<int>(candidates.size());
+    parent.resize(n);
+    buckets.clear();
+    unions = 0;
+
+    std::vector<Cell> cells(n);
+    for(int i = 0; i < n; i++) {
+        parent[i] = i;
+        const Rect& r = candidates[i];
+        int gs = scaleBucket(r.width);
+        float cell = cellSize(gs);
+        cells[i].gs = gs;
+        cells[i].gx = static_cast<int>(std::floor((r.x + r.width * 0.5f) / cell));
+        cells[i].gy = static_cast<int>(std::floor((r.y + r.height * 0.5f) / cell));
+        Bucket& bucket = buckets[key(cells[i].gx, cells[i].gy, gs)];
+        bool first = bucket.members.empty();
+        widen(bucket.left, r.x, first);
+        widen(bucket.top, r.y, first);
+        widen(bucket.right, r.x + r.width, first);
+        widen(bucket.bottom, r.y + r.height, first);
+        float extent = (r.width + r.height) * 0.5f;
+        bucket.extent = first ? extent : (std::max)(bucket.extent, extent);
+        if(first) {
+            bucket.oneSet = false;
+            bucket.checkedAt = -1;
+        }
+        bucket.members.push_back(i);
+    }
+
+    // Pairs inside each cell first, which usually leaves it a single set
+    for(auto& bucket : buckets) {
+        const std::vector<int>& members = bucket.second.members;
+        for(size_t a = 0; a + 1 < members.size() && !isOneSet(bucket.second); a++) {
+            const Rect& r = candidates[members[a]];
+            for(size_t b = a + 1; b < members.size(); b++) {
+                if(find(members[a]) == find(members[b])) continue;
+                if(similar(r, candidates[members[b]])) unite(members[a], members[b]);
+            }
+        }
+    }
+
+    // Every cell any member could reach is looked into once per bucket, not once per member
+    for(auto& bucket : buckets) {
+        const std::vector<int>& members = bucket.second.members;
+
+        // similar() lets widths differ by up to 2 * eps of the smaller one; smaller cells look up to larger ones
+        int maxWidth = 0;
+        for(int i : members) maxWidth = (std::max)(maxWidth, candidates[i].width);
+        int ownScale = cells[members[0]].gs;
+        int gsLast = scaleBucket(static_cast<int>(std::ceil(maxWidth * (1.0f + 2.0f * eps))));
+
+        for(int gs = ownScale; gs <= gsLast; gs++) {
+            float cell = cellSize(gs);
+            int gx0 = INT_MAX;
+            int gx1 = INT_MIN;
+            int gy0 = INT_MAX;
+            int gy1 = INT_MIN;
+            for(int i : members) {
+                const Rect& r = candidates[i];
+                float cx = r.x + r.width * 0.5f;
+                float cy = r.y + r.height * 0.5f;
+                float reach = eps * (r.width + r.height) * 0.5f * (1.0f + eps);
+                gx0 = (std::min)(gx0, static_cast<int>(std::floor((cx - reach) / cell)));
+                gx1 = (std::max)(gx1, static_cast<int>(std::floor((cx + reach) / cell)));
+                gy0 = (std::min)(gy0, static_cast<int>(std::floor((cy - reach) / cell)));
+                gy1 = (std::max)(gy1, static_cast<int>(std::floor((cy + reach) / cell)));
+            }
+
+            for(int gy = gy0; gy <= gy1; gy++) {
+                for(int gx = gx0; gx <= gx1; gx++) {
+                    auto it = buckets.find(key(gx, gy, gs));
+                    if(it == buckets.end() || &it->second == &bucket.second) continue;
+                    if(!mayBeSimilar(bucket.second, it->second)) continue;
+                    // Walk the hits of a cell that is one set on the inside, so each outer hit stops early
+                    if(isOneSet(bucket.second) && !isOneSet(it->second)) {
+                        joinCells(candidates, it->second, bucket.second);
+                    } else {
+                        joinCells(candidates, bucket.second, it->second);
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<int> clusterOf(n, -1);
+    std::vector<long long> sums;
+    std::vector<int> counts;
+    for(int i = 0; i < n; i++) {
+        int root = find(i);
+        if(clusterOf[root] < 0) {
+            clusterOf[root] = static_cast<int>(counts.size());
+            counts.push_back(0);
+            sums.insert(sums.end(), 4, 0);
+        }
+        int c = clusterOf[root];
+        counts[c]++;
+        sums[c * 4 + 0] += candidates[i].x;
+        sums[c * 4 + 1] += candidates[i].y;
+        sums[c * 4 + 2] += candidates[i].width;
+        sums[c * 4 + 3] += candidates[i].height;
+    }
+
+    std::vector<Rect> clusters;
+    for(size_t c = 0; c < counts.size(); c++) {
+        if(counts[c] < minNeighbours) continue;
+        int count = counts[c];
+        Rect avg(
+            static_cast<int>((sums[c * 4 + 0] + count / 2) / count),
+            static_cast<int>((sums[c * 4 + 1] + count / 2) / count),
+            static_cast<int>((sums[c * 4 + 2] + count / 2) / count),
+            static_cast<int>((sums[c * 4 + 3] + count / 2) / count)
+        );
+        avg.confidence = count;
+        clusters.push_back(avg);
+    }
+
+    // Drop clusters that sit inside a stronger one, few enough to compare pairwise
+    for(size_t i = 0; i < clusters.size(); i++) {
+        const Rect& r1 = clusters[i];
+        bool nested = false;
+        for(size_t j = 0; j < clusters.size() && !nested; j++) {
+            if(i == j) continue;
+            const Rect& r2 = clusters[j];
+            int dx = static_cast<int>(r2.width * eps);
+            int dy = static_cast<int>(r2.height * eps);
+            nested =
+                r2.confidence > (std::max)(minNeighbours, r1.confidence) &&
+                r1.x >= r2.x - dx &&
+                r1.y >= r2.y - dy &&
+                r1.x + r1.width <= r2.x + r2.width + dx &&
+                r1.y + r1.height <= r2.y + r2.height + dy;
+        }
+        if(!nested) res.push_back(r1);
+    }
+
+    return res;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "rect.h"
+
+/*
+** Groups raw cascade hits into averaged boxes. Candidates are
+** bucketed by centre and log-scale so each one is only compared
+** against hits in neighbouring cells, then merged with union-find.
+** The sets are those of a pairwise grouping: each cell looks at its
+** neighbours once, rules out whole cells by the box around their edges
+** and skips pairs already in one set. Two cells that are each a single
+** set stop at their first similar pair, which keeps dense input close
+** to linear.
+*/
+class DetectionGrouper {
+    private:
+        struct Cell {
+            int gx;
+            int gy;
+            int gs;
+        };
+
+        // Members of one cell, with the box of their edges to rule out whole cells at once
+        struct Bucket {
+            std::vector<int> members;
+            int left[2];
+            int top[2];
+            int right[2];
+            int bottom[2];
+            // Largest (width + height) / 2 among the members
+            float extent;
+            // Every member already in one union-find set
+            bool oneSet;
+            // Value of unions when oneSet was last found false
+            int checkedAt;
+        };
+
+        std::vector<int> parent;
+        int unions;
+        std::unordered_map<long long, Bucket> buckets;
+
+        int find(int i);
+        void unite(int a, int b);
+        int scaleBucket(int size) const;
+        float cellSize(int scaleBucket) const;
+        long long key(int gx, int gy, int gs) const;
+        bool similar(const Rect& a, const Rect& b) const;
+        bool mayBeSimilar(const Bucket& a, const Bucket& b) const;
+        bool mayBeSimilar(const Rect& r, const Bucket& b) const;
+        bool isOneSet(Bucket& b);
+        void joinCells(
+            const std::vector<Rect>& candidates,
+            Bucket& from,
+            Bucket& to
+        );
+
+    public:
+        int minNeighbours;
+        float eps;
+
+        DetectionGrouper(
+            int minNeighbours = 3,
+            float eps = 0.2f
+        ) :
+        unions(0),
+        minNeighbours(minNeighbours),
+        eps(eps) {}
+
+        std::vector<Rect> group(const std::vector<Rect>& candidates);
+};
@@ -1,16 +1,19 @@
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include "haar_cascade.h"
 #include "feature.h"
 #include "classifier.h"
+#include "../kernels/cascade_kernels.h"
+#include "../runtime/thread_pool.h"
 
 /*
 ** Calculate Feature Value
 */
 float calcFeatureValue(
     const Feature& f,
-    const std::vector<std::vector<float>>& integral,
+    const IntegralImage& integral,
     int x,
     int y,
     float scale
@@ -26,17 +29,7 @@ float calcFeatureValue(
         int x2,
         int y2
     ) -> float {
-        if(x1 < 0) x1 = 0;
-        if(y1 < 0) y1 = 0;
-        if(x2 >= integral[0].size()) x2 = integral[0].size() - 1;
-        if(y2 >= integral.size()) y2 = integral.size() - 1;
-
-        float A = (x1 > 0 && y1 > 0) ? integral[y1-1][x1-1] : 0;
-        float B = (y1 > 0) ? integral[y1-1][x2] : 0;
-        float C = (x1 > 0) ? integral[y2][x1-1] : 0;
-        float D = integral[y2][x2];
-        
-        return D - B - C + A;
+        return integral.rectSum(x1, y1, x2, y2);
     };
 
     float sum = 0;
@@ -162,26 +155,29 @@ float calcFeatureValue(
 ** Classify
 */
 bool WeakClassifier::classify(
-    const std::vector<std::vector<float>>& integral,
+    const IntegralImage& integral,
     int x,
     int y,
     float scale
 ) const {
     float featureValue = calcFeatureValue(feature, integral, x, y, scale);
-    static int debugCount = 0;
-    if (debugCount < 5) {
-        std::wcout << L"WeakClassifier[" << debugCount << "]: featureValue=" << featureValue 
-                   << L", threshold=" << feature.threshold 
-                   << L", leftVal=" << feature.leftVal 
-                   << L", rightVal=" << feature.rightVal 
-                   << L", leftRight=" << feature.leftRight << std::endl;
-        debugCount++;
+    // Bands are scanned from several threads, so the debug budget is shared atomically
+    static std::atomic<int> debugCount(0);
+    if(debugCount.load(std::memory_order_relaxed) < 5) {
+        int index = debugCount.fetch_add(1);
+        if(index < 5) {
+            std::wcout << L"WeakClassifier[" << index << "]: featureValue=" << featureValue 
+                       << L", threshold=" << feature.threshold 
+                       << L", leftVal=" << feature.leftVal 
+                       << L", rightVal=" << feature.rightVal 
+                       << L", leftRight=" << feature.leftRight << std::endl;
+        }
     }
     return featureValue < feature.threshold;
 }
 
 bool StrongClassifier::classify(
-    const std::vector<std::vector<float>>& integral,
+    const IntegralImage& integral,
     int x,
     int y,
     float scale
@@ -192,159 +188,182 @@ bool StrongClassifier::classify(
     
     float sum = 0.0f;
     int passedCount = 0;
+    bool softCascade = hasRejectionTrace();
     
-    for(const auto& wc : weakClassifiers) {
+    for(size_t i = 0; i < weakClassifiers.size(); i++) {
+        const WeakClassifier& wc = weakClassifiers[i];
         if(wc.classify(integral, x, y, scale)) {
             sum += wc.weight * wc.feature.leftVal;
             passedCount++;
         } else {
             sum += wc.weight * wc.feature.rightVal;
         }
+        if(softCascade && sum < rejectionTrace[i]) return false;
     }
     
     bool result = (sum >= threshold);
-    static int strongDebugCount = 0;
-    if (strongDebugCount < 5) {
-        std::wcout << L"StrongClassifier[" << strongDebugCount << "]: " << passedCount << L"/" << weakClassifiers.size() 
-                   << L" weak classifiers passed, sum=" << sum << L", threshold=" << threshold 
-                   << L", result=" << result << std::endl;
-        strongDebugCount++;
+    static std::atomic<int> strongDebugCount(0);
+    if(strongDebugCount.load(std::memory_order_relaxed) < 5) {
+        int index = strongDebugCount.fetch_add(1);
+        if(index < 5) {
+            std::wcout << L"StrongClassifier[" << index << "]: " << passedCount << L"/" << weakClassifiers.size() 
+                       << L" weak classifiers passed, sum=" << sum << L", threshold=" << threshold 
+                       << L", result=" << result << std::endl;
+        }
     }
     
     return result;
 }
 
-std::vector<Rect> HaarCascade::nonMaximumSuppression(
-    const std::vector<Rect>& faces,
-    float overlapThreshold
-) {
-    if(faces.empty()) {
-        return faces;
-    }
+/*
+** Evaluate
+*/
+float StrongClassifier::evaluate(
+    const IntegralImage& integral,
+    int x,
+    int y,
+    float scale,
+    std::vector<float>* partialSums
+) const {
+    float sum = 0.0f;
+    if(partialSums) partialSums->resize(weakClassifiers.size());
 
-    std::vector<Rect> res;
-    std::vector<bool> suppresed(faces.size(), false);
-    
-    std::vector<Rect> filteredFaces;
-    for(const auto& face : faces) {
-        if(face.width >= 30 && face.height >= 30) {
-            filteredFaces.push_back(face);
+    for(size_t i = 0; i < weakClassifiers.size(); i++) {
+        const WeakClassifier& wc = weakClassifiers[i];
+        if(wc.classify(integral, x, y, scale)) {
+            sum += wc.weight * wc.feature.leftVal;
+        } else {
+            sum += wc.weight * wc.feature.rightVal;
         }
+        if(partialSums) (*partialSums)[i] = sum;
     }
-    std::wcout << L"Filtered " << (faces.size() - filteredFaces.size()) << " very small faces" << std::endl;
-    std::vector<size_t> indices(filteredFaces.size());
-    for(size_t i = 0; i < filteredFaces.size(); i++) {
-        indices[i] = i;
-    }
-    std::sort(
-        indices.begin(),
-        indices.end(),
-        [&](
-            size_t i1,
-            size_t i2
-        ) 
-    {
-        return (
-            filteredFaces[i1].width * filteredFaces[i1].height >
-            (filteredFaces[i2].width * filteredFaces[i2].height)
-        );
-    });
-    for(size_t i = 0; i < filteredFaces.size(); i++) {
-        if(suppresed[indices[i]]) continue;
-        res.push_back(filteredFaces[indices[i]]);
-        for(size_t j = i+1; j < filteredFaces.size(); j++) {
-            if(suppresed[indices[j]]) continue;
+    return sum;
+}
 
-            const Rect& r1 = filteredFaces[indices[i]];
-            const Rect& r2 = filteredFaces[indices[j]];
-            
-            int x1 = std::max(r1.x, r2.x);
-            int y1 = std::max(r1.y, r2.y);
-            int x2 = std::min(r1.x + r1.width, r2.x + r2.width);
-            int y2 = std::min(r1.y + r1.height, r2.y + r2.height);
-            if(x2 > x1 && y2 > y1) {
-                int intersection = (x2 - x1) * (y2 - y1);
-                int area1 = r1.width * r1.height;
-                int area2 = r2.width * r2.height;
-                float overlap = static_cast<float>(intersection) / std::min(area1, area2);
-                if(overlap > overlapThreshold) {
-                    suppresed[indices[j]] = true;
-                }
-            }
-        } 
+/*
+** Evaluate Window
+*/
+bool HaarCascade::evaluateWindow(
+    const IntegralImage& integral,
+    int x,
+    int y,
+    float scale
+) const {
+    for(const auto& stage : stages) {
+        if(!stage.classify(integral, x, y, scale)) return false;
     }
+    return true;
+}
 
-    std::wcout << L"Nonmaximum suppression: " << filteredFaces.size() << L" -> " << res.size() << L" faces" << std::endl;
-    return res;
+/*
+** Scan Band
+*/
+void HaarCascade::scanBand(
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    size_t band,
+    std::vector<Rect>& out
+) const {
+    CascadeKernels::sweepBand(*this, integral, plan, band, out);
 }
 
 /*
 ** Detect Faces
 */
-std::vector<Rect> HaarCascade::detectFaces(
-    const std::vector<std::vector<float>>& integral,
-    int minSize,
-    int maxSize,
-    float scaleFactor
-) {
-    std::vector<Rect> faces;
-    if(integral.empty() || integral[0].empty()) {
+bool HaarCascade::scanWindows(
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    std::vector<Rect>& candidates,
+    ThreadPool* pool
+) const {
+    candidates.clear();
+    if(integral.empty()) {
         std::wcout << L"HaarCascade empty integral img" << std::endl;
-        return faces;
+        return false;
     }
     if(stages.empty()) {
         std::wcout << L"No stages in cascade!" << std::endl;
-        return faces;
+        return false;
     }
     if(stages[0].weakClassifiers.empty()) {
         std::wcout << L"First stage has no weak classifiers!" << std::endl;
-        return faces;
+        return false;
     }
 
-    int width = integral[0].size();
-    int height = integral.size();
-
-    std::wcout << L"Detecting faces in " << width << "x" << height 
-               << " image with " << stages.size() << " stages" << std::endl;
-    std::wcout << L"First stage has " << stages[0].weakClassifiers.size() << " weak classifiers" << std::endl;
-
-    if(maxSize > width || maxSize > height) {
-        maxSize = std::min(width, height);
-        std::wcout << L"Adjusted maxSize to " << maxSize << std::endl;
-    }
-    if(minSize > maxSize) {
-        minSize = 20;
-        std::wcout << L"Adjusted minSize to " << minSize << std::endl;
+    int width = integral.width;
+    int height = integral.height;
+    if(plan.frameWidth != width || plan.frameHeight != height) {
+        std::wcout << L"Window plan is for " << plan.frameWidth << L"x" << plan.frameHeight
+                   << L", frame is " << width << L"x" << height << std::endl;
+        return false;
     }
-    std::wcout << L"Scanning window sizes from " << minSize << " to " << maxSize << std::endl;
 
-    int totalWindows = 0;
-    int passedStages = 0;
-    for(int windowSize = minSize; windowSize <= maxSize; windowSize = static_cast<int>(windowSize * scaleFactor)) {
-        float scale = static_cast<float>(windowSize) / baseWidth;
-        for(int y = 0; y <= height - windowSize; y += 3) {
-            for(int x = 0; x <= width - windowSize; x += 3) {
-                totalWindows++;
-                bool passedAllStages = true;
-                for(const auto& stage : stages) {
-                    if(!stage.classify(integral, x, y, scale)) {
-                        passedAllStages = false;
-                        break;
-                    }
-                }
-                if(passedAllStages) {
-                    faces.push_back(Rect(x, y, windowSize, windowSize));
-                    passedStages++;
-                }
+    size_t bandCount = plan.bands.size();
+    if(pool && pool->size() > 1 && bandCount > 1) {
+        // Contiguous runs of bands, joined in order so the result matches the serial scan
+        size_t chunks = (std::min)(bandCount, pool->size() * 4);
+        std::vector<std::vector<Rect>> chunkFaces(chunks);
+        pool->parallelFor(chunks, [&](size_t chunk) {
+            size_t end = (chunk + 1) * bandCount / chunks;
+            for(size_t band = chunk * bandCount / chunks; band < end; band++) {
+                scanBand(integral, plan, band, chunkFaces[chunk]);
             }
+        });
+        for(const auto& part : chunkFaces) candidates.insert(candidates.end(), part.begin(), part.end());
+    } else {
+        for(size_t band = 0; band < bandCount; band++) {
+            scanBand(integral, plan, band, candidates);
         }
     }
+    return true;
+}
 
-    std::wcout << L"**Processed " << totalWindows << " windows, found " 
-               << faces.size() << " faces before NMS" << std::endl;
+/*
+** Boxes found on a decimated integral, back in frame coordinates
+*/
+void HaarCascade::scaleToFrame(std::vector<Rect>& faces, int decimation) {
+    if(decimation <= 1) return;
+    for(auto& face : faces) {
+        face.x *= decimation;
+        face.y *= decimation;
+        face.width *= decimation;
+        face.height *= decimation;
+    }
+}
 
-    faces = nonMaximumSuppression(faces, 0.3f);
+std::vector<Rect> HaarCascade::detectFaces(
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    ThreadPool* pool
+) {
+    std::vector<Rect> faces;
+    if(!scanWindows(integral, plan, faces, pool)) return faces;
 
-    std::wcout << L"HaarCascade: " << faces.size() << " faces after NMS" << std::endl;
+    faces = grouper.group(faces);
+    scaleToFrame(faces, plan.config.decimation);
     return faces;
-}
\ No newline at end of file
+}
+
+std::vector<Rect> HaarCascade::detectFaces(
+    const IntegralImage& integral,
+    int minSize,
+    int maxSize,
+    float scaleFactor,
+    const ScaleMap* scaleMap
+) {
+    if(integral.empty()) {
+        std::wcout << L"HaarCascade empty integral img" << std::endl;
+        return std::vector<Rect>();
+    }
+
+    WindowPlan plan;
+    plan.build(
+        integral.width,
+        integral.height,
+        baseWidth,
+        ScanConfig(minSize, maxSize, scaleFactor),
+        nullptr,
+        scaleMap
+    );
+    return detectFaces(integral, plan);
+}
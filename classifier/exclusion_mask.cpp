@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "exclusion_mask.h"
+
+/*
+** Excludes
+*/
+bool ExclusionMask::excludes(int x, int y, int size) const {
+    if(regions.empty() || size <= 0) return false;
+
+    long long covered = 0;
+    for(const auto& r : regions) {
+        int x1 = (std::max)(x, r.x);
+        int y1 = (std::max)(y, r.y);
+        int x2 = (std::min)(x + size, r.x + r.width);
+        int y2 = (std::min)(y + size, r.y + r.height);
+        if(x2 > x1 && y2 > y1) {
+            covered += static_cast<long long>(x2 - x1) * (y2 - y1);
+        }
+    }
+
+    long long area = static_cast<long long>(size) * size;
+    return covered > static_cast<long long>(area * maxOverlap);
+}
+
+/*
+** Load
+*/
+bool ExclusionMask::load(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if(!file.is_open()) {
+        std::wcout << L"Failed to open exclusion mask: " << fileName.c_str() << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::vector<Rect> loaded;
+    while(std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string first;
+        if(!(stream >> first) || first[0] == '#') continue;
+
+        if(first == "overlap") {
+            float overlap = 0.0f;
+            if(stream >> overlap) {
+                maxOverlap = overlap;
+                continue;
+            }
+        } else {
+            std::istringstream row(line);
+            Rect r;
+            if(row >> r.x >> r.y >> r.width >> r.height) {
+                if(r.width > 0 && r.height > 0) loaded.push_back(r);
+                continue;
+            }
+        }
+        std::wcout << L"Malformed exclusion mask line skipped: " << line.c_str() << std::endl;
+    }
+
+    regions = loaded;
+    revision++;
+    std::wcout << L"Exclusion mask loaded with " << regions.size() << L" regions" << std::endl;
+    return true;
+}
+
+bool ExclusionMask::save(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if(!file.is_open()) return false;
+
+    file << "# x y width height\n";
+    file << "overlap " << maxOverlap << "\n";
+    for(const auto& r : regions) {
+        file << r.x << " " << r.y << " " << r.width << " " << r.height << "\n";
+    }
+    return true;
+}
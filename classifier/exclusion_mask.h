@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "rect.h"
+
+/*
+** Per-camera regions the detector should ignore (screens, posters,
+** mirrors). A window is dropped when more than maxOverlap of its area
+** falls inside the mask.
+*/
+class ExclusionMask {
+    public:
+        std::vector<Rect> regions;
+        float maxOverlap;
+        int revision;
+
+        ExclusionMask(float maxOverlap = 0.5f) :
+            maxOverlap(maxOverlap),
+            revision(0) {}
+
+        bool isEmpty() const {
+            return regions.empty();
+        }
+        void addRegion(const Rect& region) {
+            regions.push_back(region);
+            revision++;
+        }
+        void clear() {
+            regions.clear();
+            revision++;
+        }
+        bool excludes(
+            int x,
+            int y,
+            int size
+        ) const;
+
+        bool load(const std::string& fileName);
+        bool save(const std::string& fileName) const;
+};
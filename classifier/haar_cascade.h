@@ -5,6 +5,11 @@
 #include <fstream>
 #include <iostream>
 #include "classifier.h"
+#include "detection_grouper.h"
+#include "scale_map.h"
+#include "window_plan.h"
+
+class ThreadPool;
 
 class HaarCascade {
     public:
@@ -12,21 +17,47 @@ class HaarCascade {
         int baseWidth;
         int baseHeight;
         bool loaded;
+        DetectionGrouper grouper;
 
         HaarCascade() : 
             baseWidth(24), 
             baseHeight(24),
             loaded(false) {}
 
+        bool evaluateWindow(
+            const IntegralImage& integral,
+            int x,
+            int y,
+            float scale
+        ) const;
+        void scanBand(
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            size_t band,
+            std::vector<Rect>& out
+        ) const;
+        /*
+        ** Every window of the plan the cascade accepts, ungrouped and in
+        ** integral coordinates. Safe to call from several threads.
+        */
+        bool scanWindows(
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            std::vector<Rect>& candidates,
+            ThreadPool* pool = nullptr
+        ) const;
+        static void scaleToFrame(std::vector<Rect>& faces, int decimation);
+        std::vector<Rect> detectFaces(
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            ThreadPool* pool = nullptr
+        );
         std::vector<Rect> detectFaces(
-            const std::vector<std::vector<float>>& integral,
+            const IntegralImage& integral,
             int minSize = 24,
             int maxSize = 400,
-            float scaleFactor = 1.25f
-        );
-        std::vector<Rect> nonMaximumSuppression(
-            const std::vector<Rect>& faces,
-            float overlapThreshold = 0.3f
+            float scaleFactor = 1.25f,
+            const ScaleMap* scaleMap = nullptr
         );
         void addStage(const StrongClassifier& stage) {
             stages.push_back(stage);
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include "integral_image.h"
+
+void IntegralImage::resize(int w, int h, bool withSquared) {
+    width = (std::max)(w, 0);
+    height = (std::max)(h, 0);
+    stride = static_cast<size_t>(width) + 1;
+    hasSquared = withSquared;
+
+    size_t cells = stride * (static_cast<size_t>(height) + 1);
+    sum.resize(cells);
+    std::fill(sum.begin(), sum.begin() + stride, 0.0f);
+    if(withSquared) {
+        squared.resize(cells);
+        std::fill(squared.begin(), squared.begin() + stride, 0.0);
+    }
+}
+
+double IntegralImage::rectSquaredSum(int x1, int y1, int x2, int y2) const {
+    if(!hasSquared) return 0.0;
+    if(x1 < 0) x1 = 0;
+    if(y1 < 0) y1 = 0;
+    if(x2 >= width) x2 = width - 1;
+    if(y2 >= height) y2 = height - 1;
+
+    const double* top = squared.data() + y1 * stride;
+    const double* bottom = squared.data() + (y2 + 1) * stride;
+    return bottom[x2 + 1] - top[x2 + 1] - bottom[x1] + top[x1];
+}
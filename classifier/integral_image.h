@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+/*
+** Contiguous integral image with a zero top row and left column, so
+** sum[(y + 1) * stride + (x + 1)] is the sum of every pixel up to and
+** including (x, y). Resizing keeps the allocation, so one instance can
+** be reused frame after frame.
+*/
+class IntegralImage {
+    public:
+        int width;
+        int height;
+        size_t stride;
+        std::vector<float> sum;
+        std::vector<double> squared;
+        bool hasSquared;
+
+        IntegralImage() :
+            width(0),
+            height(0),
+            stride(0),
+            hasSquared(false) {}
+
+        void resize(
+            int w,
+            int h,
+            bool withSquared
+        );
+        bool empty() const {
+            return width <= 0 || height <= 0;
+        }
+
+        float rectSum(
+            int x1,
+            int y1,
+            int x2,
+            int y2
+        ) const {
+            if(x1 < 0) x1 = 0;
+            if(y1 < 0) y1 = 0;
+            if(x2 >= width) x2 = width - 1;
+            if(y2 >= height) y2 = height - 1;
+
+            const float* top = sum.data() + y1 * stride;
+            const float* bottom = sum.data() + (y2 + 1) * stride;
+            return bottom[x2 + 1] - top[x2 + 1] - bottom[x1] + top[x1];
+        }
+        double rectSquaredSum(
+            int x1,
+            int y1,
+            int x2,
+            int y2
+        ) const;
+};
@@ -7,6 +7,7 @@ class Rect {
         int y;
         int width;
         int height;
+        int confidence;
 
         Rect(
             int x = 0,
@@ -17,7 +18,8 @@ class Rect {
         x(x),
         y(y),
         width(w),
-        height(h) {}
+        height(h),
+        confidence(0) {}
 
         bool operator==(const Rect& other) const {
             return x == other.x &&
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include "scale_map.h"
+
+void ScaleMap::reset(int bandCount) {
+    bands.assign((std::max)(bandCount, 0), Band());
+    stableSamples = 0;
+    revision++;
+}
+
+void ScaleMap::setBand(int i, int minSize, int maxSize) {
+    if(i < 0 || i >= static_cast<int>(bands.size())) return;
+    bands[i].minSize = minSize;
+    bands[i].maxSize = maxSize;
+    revision++;
+}
+
+/*
+** Get Range
+*/
+bool ScaleMap::getRange(int band, int& minSize, int& maxSize) const {
+    if(band < 0 || band >= static_cast<int>(bands.size())) return false;
+
+    const Band& b = bands[band];
+    if(b.maxSize > 0) {
+        minSize = b.minSize;
+        maxSize = b.maxSize;
+        return true;
+    }
+    if(b.samples >= minSamples) {
+        minSize = static_cast<int>(b.observedMin * (1.0f - margin));
+        maxSize = static_cast<int>(b.observedMax * (1.0f + margin) + 0.5f);
+        return true;
+    }
+    return false;
+}
+
+bool ScaleMap::allows(int y, int size, int frameHeight) const {
+    if(bands.empty() || frameHeight <= 0) return true;
+
+    int band = static_cast<int>(
+        static_cast<long long>((std::max)(y, 0)) * bands.size() / frameHeight
+    );
+    band = (std::min)(band, static_cast<int>(bands.size()) - 1);
+
+    int minSize = 0;
+    int maxSize = 0;
+    if(!getRange(band, minSize, maxSize)) return true;
+    return size >= minSize && size <= maxSize;
+}
+
+/*
+** Learn
+*/
+void ScaleMap::learn(const std::vector<Rect>& detections, int frameHeight) {
+    if(bands.empty() || frameHeight <= 0) return;
+
+    for(const auto& face : detections) {
+        int cy = face.y + face.height / 2;
+        int band = static_cast<int>(
+            static_cast<long long>((std::max)(cy, 0)) * bands.size() / frameHeight
+        );
+        band = (std::min)(band, static_cast<int>(bands.size()) - 1);
+
+        Band& b = bands[band];
+        bool changed = false;
+        if(b.samples == 0 || face.width < b.observedMin) {
+            b.observedMin = face.width;
+            changed = true;
+        }
+        if(b.samples == 0 || face.width > b.observedMax) {
+            b.observedMax = face.width;
+            changed = true;
+        }
+        b.samples++;
+        if(b.maxSize == 0 && (b.samples == minSamples || (changed && b.samples > minSamples))) {
+            revision++;
+            stableSamples = 0;
+        } else if(b.samples >= minSamples) {
+            stableSamples++;
+        }
+    }
+}
+
+/*
+** Converged
+**
+** Learned once some band has its range and the last `needed` faces
+** in learned bands all fell inside what was already seen.
+*/
+bool ScaleMap::hasConverged(int needed) const {
+    return stableSamples >= needed;
+}
+
+/*
+** Load
+*/
+bool ScaleMap::load(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if(!file.is_open()) {
+        std::wcout << L"Failed to open scale map: " << fileName.c_str() << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::vector<Band> loaded;
+    while(std::getline(file, line)) {
+        std::istringstream stream(line);
+        std::string first;
+        if(!(stream >> first) || first[0] == '#') continue;
+
+        if(first == "bands") {
+            int count = 0;
+            if(stream >> count) {
+                if(count < 0 || count > MAX_BANDS) {
+                    std::wcout << L"Scale map band count " << count << L" outside 0.." << MAX_BANDS
+                               << L", keeping the current map" << std::endl;
+                    return false;
+                }
+                loaded.assign(count, Band());
+                continue;
+            }
+        } else {
+            std::istringstream row(line);
+            int i = 0;
+            int minSize = 0;
+            int maxSize = 0;
+            if(row >> i >> minSize >> maxSize) {
+                if(i >= 0 && i < static_cast<int>(loaded.size())) {
+                    loaded[i].minSize = minSize;
+                    loaded[i].maxSize = maxSize;
+                }
+                continue;
+            }
+        }
+        std::wcout << L"Malformed scale map line skipped: " << line.c_str() << std::endl;
+    }
+
+    bands = loaded;
+    stableSamples = 0;
+    revision++;
+    std::wcout << L"Scale map loaded with " << bands.size() << L" bands" << std::endl;
+    return !bands.empty();
+}
+
+bool ScaleMap::save(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if(!file.is_open()) return false;
+
+    file << "# band minSize maxSize\n";
+    file << "bands " << bands.size() << "\n";
+    for(size_t i = 0; i < bands.size(); i++) {
+        int minSize = 0;
+        int maxSize = 0;
+        if(getRange(static_cast<int>(i), minSize, maxSize)) {
+            file << i << " " << minSize << " " << maxSize << "\n";
+        }
+    }
+    return true;
+}
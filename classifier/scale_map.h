@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "rect.h"
+
+/*
+** Allowed face size range per horizontal image band. Bands can be
+** configured from a file or learned from past detections; a band with
+** neither stays unrestricted.
+*/
+class ScaleMap {
+    public:
+        // One band per row of a 4K frame; anything finer is a broken file
+        static const int MAX_BANDS = 2160;
+
+        struct Band {
+            int minSize;
+            int maxSize;
+            int observedMin;
+            int observedMax;
+            int samples;
+
+            Band() :
+                minSize(0),
+                maxSize(0),
+                observedMin(0),
+                observedMax(0),
+                samples(0) {}
+        };
+
+        std::vector<Band> bands;
+        float margin;
+        int minSamples;
+        int revision;
+        // Faces in a row that fell inside an already learned range
+        int stableSamples;
+
+        ScaleMap(
+            int bandCount = 0,
+            float margin = 0.25f,
+            int minSamples = 5
+        ) :
+        bands(bandCount),
+        margin(margin),
+        minSamples(minSamples),
+        revision(0),
+        stableSamples(0) {}
+
+        bool isEmpty() const {
+            return bands.empty();
+        }
+        void reset(int bandCount);
+        void setBand(
+            int i,
+            int minSize,
+            int maxSize
+        );
+        bool getRange(
+            int band,
+            int& minSize,
+            int& maxSize
+        ) const;
+        bool allows(
+            int y,
+            int size,
+            int frameHeight
+        ) const;
+        void learn(
+            const std::vector<Rect>& detections,
+            int frameHeight
+        );
+        bool hasConverged(int needed) const;
+
+        bool load(const std::string& fileName);
+        bool save(const std::string& fileName) const;
+};
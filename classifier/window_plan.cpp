@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <iostream>
+#include "window_plan.h"
+
+bool WindowPlan::matches(
+    int width,
+    int height,
+    int cascadeBaseWidth,
+    const ScanConfig& scanConfig,
+    const ExclusionMask* mask,
+    const ScaleMap* scaleMap
+) const {
+    return built &&
+        frameWidth == width &&
+        frameHeight == height &&
+        baseWidth == cascadeBaseWidth &&
+        config == scanConfig &&
+        maskRevision == (mask ? mask->revision : -1) &&
+        scaleMapRevision == (scaleMap ? scaleMap->revision : -1);
+}
+
+/*
+** Build
+*/
+void WindowPlan::build(
+    int width,
+    int height,
+    int cascadeBaseWidth,
+    const ScanConfig& scanConfig,
+    const ExclusionMask* mask,
+    const ScaleMap* scaleMap,
+    int bandCount
+) {
+    levels.clear();
+    windows.clear();
+    bands.clear();
+
+    frameWidth = width;
+    frameHeight = height;
+    baseWidth = cascadeBaseWidth;
+    config = scanConfig;
+    maskRevision = mask ? mask->revision : -1;
+    scaleMapRevision = scaleMap ? scaleMap->revision : -1;
+    built = true;
+
+    if(width <= 0 || height <= 0 || cascadeBaseWidth <= 0) return;
+
+    int decimation = (std::max)(config.decimation, 1);
+    int minSize = (config.minSize + decimation - 1) / decimation;
+    int maxSize = config.maxSize / decimation;
+    int step = (std::max)(config.step, 1);
+    if(maxSize > width || maxSize > height) {
+        maxSize = (std::min)(width, height);
+    }
+    if(minSize > maxSize) {
+        minSize = (std::min)(20, maxSize);
+    }
+
+    for(int windowSize = minSize; windowSize <= maxSize; ) {
+        Level level;
+        level.size = windowSize;
+        level.scale = static_cast<float>(windowSize) / cascadeBaseWidth;
+        levels.push_back(level);
+
+        int next = static_cast<int>(windowSize * config.scaleFactor);
+        windowSize = (std::max)(next, windowSize + 1);
+    }
+
+    bandCount = (std::max)(bandCount, 1);
+    int bandRows = (height + bandCount - 1) / bandCount;
+    for(int b = 0; b < bandCount; b++) {
+        Band band;
+        band.begin = windows.size();
+
+        int rowStart = b * bandRows;
+        int rowEnd = (std::min)(height, rowStart + bandRows);
+        for(size_t l = 0; l < levels.size(); l++) {
+            int windowSize = levels[l].size;
+            int firstRow = ((rowStart + step - 1) / step) * step;
+            for(int y = firstRow; y < rowEnd && y <= height - windowSize; y += step) {
+                if(
+                    scaleMap &&
+                    !scaleMap->allows((y + windowSize / 2) * decimation, windowSize * decimation, height * decimation)
+                ) {
+                    continue;
+                }
+                for(int x = 0; x <= width - windowSize; x += step) {
+                    if(mask && mask->excludes(x * decimation, y * decimation, windowSize * decimation)) continue;
+
+                    Window w;
+                    w.x = static_cast<uint16_t>(x);
+                    w.y = static_cast<uint16_t>(y);
+                    w.level = static_cast<uint16_t>(l);
+                    windows.push_back(w);
+                }
+            }
+        }
+
+        band.end = windows.size();
+        bands.push_back(band);
+    }
+
+    std::wcout << L"Window plan built for " << width << L"x" << height
+               << L" (1/" << decimation << L")"
+               << L": " << levels.size() << L" scales, " << windows.size()
+               << L" windows in " << bands.size() << L" bands" << std::endl;
+}
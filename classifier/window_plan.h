@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "exclusion_mask.h"
+#include "scale_map.h"
+
+struct ScanConfig {
+    int minSize;
+    int maxSize;
+    float scaleFactor;
+    int step;
+    // Detection runs on a 1/decimation box-filtered image; sizes stay in frame pixels
+    int decimation;
+
+    ScanConfig(
+        int minSize = 24,
+        int maxSize = 400,
+        float scaleFactor = 1.25f,
+        int step = 3,
+        int decimation = 1
+    ) :
+    minSize(minSize),
+    maxSize(maxSize),
+    scaleFactor(scaleFactor),
+    step(step),
+    decimation(decimation) {}
+
+    bool operator==(const ScanConfig& other) const {
+        return minSize == other.minSize &&
+            maxSize == other.maxSize &&
+            scaleFactor == other.scaleFactor &&
+            step == other.step &&
+            decimation == other.decimation;
+    }
+    bool operator!=(const ScanConfig& other) const {
+        return !(*this == other);
+    }
+};
+
+/*
+** Flat list of every (position, size) the detector should evaluate for
+** one frame size, cascade, scan config, scale map and exclusion mask.
+** Windows are grouped into horizontal bands by their top row so each
+** band can be scanned independently. Width and height are those of the
+** (possibly decimated) detection image, while the mask and scale map stay
+** in full-resolution frame coordinates.
+*/
+class WindowPlan {
+    public:
+        struct Level {
+            int size;
+            float scale;
+        };
+        struct Window {
+            uint16_t x;
+            uint16_t y;
+            uint16_t level;
+        };
+        struct Band {
+            size_t begin;
+            size_t end;
+        };
+
+        std::vector<Level> levels;
+        std::vector<Window> windows;
+        std::vector<Band> bands;
+
+        int frameWidth;
+        int frameHeight;
+        int baseWidth;
+        ScanConfig config;
+        int maskRevision;
+        int scaleMapRevision;
+        bool built;
+
+        WindowPlan() :
+            frameWidth(0),
+            frameHeight(0),
+            baseWidth(0),
+            maskRevision(-1),
+            scaleMapRevision(-1),
+            built(false) {}
+
+        bool matches(
+            int width,
+            int height,
+            int cascadeBaseWidth,
+            const ScanConfig& scanConfig,
+            const ExclusionMask* mask,
+            const ScaleMap* scaleMap
+        ) const;
+        void build(
+            int width,
+            int height,
+            int cascadeBaseWidth,
+            const ScanConfig& scanConfig,
+            const ExclusionMask* mask = nullptr,
+            const ScaleMap* scaleMap = nullptr,
+            int bandCount = 16
+        );
+        size_t size() const {
+            return windows.size();
+        }
+};
@@ -8,25 +8,41 @@
 #include <d3d9.h>
 #include <cmath>
 
+namespace {
+    const char* SCALE_MAP_FILE = "../.data/scale_map.txt";
+    const int SCALE_MAP_BANDS = 8;
+}
+
 CaptureController::CaptureController(WindowManager& wm) :
     windowManager(wm),
     m_cRef(1),
     pVideoSource(nullptr),
     sourceReader(nullptr),
     frameConverter(nullptr),
+    threadPool(nullptr),
     ppDevices(nullptr),
     deviceCount(0),
     pSession(nullptr),
     pVideoDisplay(nullptr),
     isRunning(false),
+    learnScaleMap(true),
     faceDetectionEnabled(true),
     classifierRenderer(),
     d2dRenderer(nullptr),
     useD2D(false),
-    frameReady(false)
+    frameReady(false),
+    formatRevision(0),
+    setupTasks(ThreadPool::shared())
 {
     sourceReader = new SourceReader();
-    frameConverter = new FrameConverter();
+    threadPool = &ThreadPool::shared();
+    frameConverter = new FrameConverter(threadPool);
+    classifierRenderer.setThreadPool(threadPool);
+    classifierRenderer.setFacesCallback([this](const std::vector<Rect>& faces) {
+        onFacesDetected(faces);
+    });
+    std::wcout << L"Preprocessing tiled from " << FrameConverter::PARALLEL_MIN_PIXELS
+               << L" pixels on " << threadPool->size() << L" threads" << std::endl;
 
     InitializeCriticalSection(&frameCriticalSection);
     HRESULT hr = MFStartup(MF_VERSION);
@@ -34,7 +50,7 @@ CaptureController::CaptureController(WindowManager& wm) :
 }
 CaptureController::~CaptureController() {
     cleanup();
-    stopDetectionThread();
+    stopDetection();
     DeleteCriticalSection(&frameCriticalSection);
     MFShutdown();
     if(d2dRenderer) {
@@ -183,14 +199,25 @@ bool CaptureController::setupDevice(const std::wstring& deviceId) {
         return false;
     }
 
-    if(!sourceReader->createSourceReaderWithRes(this, pCaptureSource, 1280, 720)) {
-        std::wcout << L"Failed to create source reader with 1280x720" << std::endl;
+    streamFormat.reset();
+    if(!sourceReader->openReader(this, pCaptureSource)) {
+        std::wcout << L"Failed to create source reader" << std::endl;
         pCaptureSource->Release();
         return false;
     }
     pCaptureSource->Release();
-    
-    return true;
+
+    // Detection scans the half-resolution image, see enableFaceDetection()
+    CaptureBudget budget;
+    budget.decimation = 2;
+    captureModes.setConfig(CaptureModeSelector::Config(budget));
+    modePending = false;
+
+    CaptureMode mode;
+    if(!captureModes.select(sourceReader->listModes(), mode) || !sourceReader->setMode(mode)) {
+        std::wcout << L"Keeping the device's default capture mode" << std::endl;
+    }
+    return sourceReader->requestSample();
 }
 
 IDevice* CaptureController::getCurrentDevice() const {
@@ -207,12 +234,31 @@ bool CaptureController::refreshDevices() {
 void CaptureController::enableFaceDetection(bool enable) {
     faceDetectionEnabled = enable;
     if(enable) {
-        if(!classifierRenderer.isCascadeLoaded()) {
-            std::wcout << L"Loading cascade..." << std::endl;
-            loadCascade("../.data/haarcascade_frontalface_default.xml");
-            classifierRenderer.forceEnable();
-        }
-        startDetectionThread();
+        // A load still in flight from an earlier call must not race this one
+        setupTasks.wait();
+
+        // Cascade and mask files load on the pool; detection starts once they are in
+        setupTasks.run([this]() {
+            if(!classifierRenderer.isCascadeLoaded()) {
+                std::wcout << L"Loading cascade..." << std::endl;
+                loadCascade("../.data/haarcascade_frontalface_default.xml");
+                classifierRenderer.forceEnable();
+            }
+            if(
+                classifierRenderer.scaleMap.isEmpty() &&
+                !classifierRenderer.loadScaleMap(SCALE_MAP_FILE) &&
+                learnScaleMap
+            ) {
+                std::wcout << L"Learning a scale map from detections" << std::endl;
+                classifierRenderer.enableScaleMapLearning(SCALE_MAP_BANDS, SCALE_MAP_FILE);
+            }
+            if(classifierRenderer.exclusionMask.isEmpty()) {
+                classifierRenderer.loadExclusionMask("../.data/exclusion_mask.txt");
+            }
+            // Faces at 720p are 80+ pixels, so scan the half-resolution image
+            classifierRenderer.setDecimation(2);
+            startDetection();
+        });
     } else {
         std::wcout << "Enable face detection FATAL ERR." << std::endl;
     }
@@ -229,10 +275,12 @@ void CaptureController::loadCascade(const std::string& file) {
     }
 }
 
-void CaptureController::getCurrentFrame(std::vector<std::vector<unsigned char>>& frame) {
+FrameHandle CaptureController::getCurrentFrame() {
+    FrameHandle latest;
     EnterCriticalSection(&frameCriticalSection);
-    if(frameReady) frame = currentFrame;
+    if(frameReady) latest = currentFrame;
     LeaveCriticalSection(&frameCriticalSection);
+    return latest;
 }
 
 /*
@@ -292,39 +340,31 @@ STDMETHODIMP CaptureController::OnReadSample(
             return S_OK;
         }
 
-        UINT32 frameWidth = 0;
-        UINT32 frameHeight = 0;
-        GUID pixelFormat = GUID_NULL;
-        IMFMediaType* pMediaType = nullptr;
-        HRESULT hr = sourceReader->pReader->GetCurrentMediaType(
-            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
-            &pMediaType
-        );
-        if(SUCCEEDED(hr) && pMediaType) {
-            hr = MFGetAttributeSize(
-                pMediaType,
-                MF_MT_FRAME_SIZE,
-                &frameWidth,
-                &frameHeight
+        if(!streamFormat || (dwStreamFlags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED)) {
+            streamFormat = sourceReader->readCurrentFormat(++formatRevision);
+        }
+        if(!streamFormat) {
+            std::wcout << L"No negotiated format, skipping frame" << std::endl;
+            sourceReader->pReader->ReadSample(
+                MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+                0,
+                nullptr,
+                nullptr,
+                nullptr,
+                nullptr
             );
-            pMediaType->GetGUID(MF_MT_SUBTYPE, &pixelFormat);
-            pMediaType->Release();
-            
-            if(SUCCEEDED(hr)) {
-                std::wcout << L"Actual frame resolution: " << frameWidth 
-                        << L"x" << frameHeight << std::endl;
-            }
+            return S_OK;
         }
         
         if(useD2D) {
             std::wcout << L"Rendering with D2D" << std::endl;
-            if(d2dRenderer->renderFrame(pSample, frameWidth, frameHeight, pixelFormat)) {
+            if(d2dRenderer->renderFrame(pSample, *streamFormat)) {
                 windowManager.updateOverlayWindow();
             }
         }
 
         IMFMediaBuffer* pBuffer = nullptr;
-        hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+        HRESULT hr = pSample->ConvertToContiguousBuffer(&pBuffer);
         if(SUCCEEDED(hr)) {
             BYTE* pData = nullptr;
             DWORD maxLength;
@@ -332,25 +372,31 @@ STDMETHODIMP CaptureController::OnReadSample(
 
             hr = pBuffer->Lock(&pData, &maxLength, &currentLength);
             if(SUCCEEDED(hr) && pData && currentLength > 0) {
-                auto frame = frameConverter->convertToGrayscale(
-                    pData, 
+                // An exhausted pool drops the frame; the pool counts it for stopDetection()
+                FrameHandle frame = framePool.acquire();
+                if(frame && frameConverter->copyFrame(
+                    pData,
                     currentLength,
-                    sourceReader->pReader
-                );
-                EnterCriticalSection(&frameCriticalSection);
-                currentFrame = frame;
-                frameReady = true;
-                LeaveCriticalSection(&frameCriticalSection);
-
-                if(faceDetectionEnabled && detectionRunning) {
-                    pushFrameToQueue(frame);
+                    streamFormat,
+                    llTimestamp,
+                    frame.writable()
+                )) {
+                    if(faceDetectionEnabled && detectionRunning) {
+                        publishFrame(frame);
+                    }
+
+                    EnterCriticalSection(&frameCriticalSection);
+                    currentFrame = std::move(frame);
+                    frameReady = true;
+                    LeaveCriticalSection(&frameCriticalSection);
                 }
 
                 pBuffer->Unlock();
             }   
             pBuffer->Release();
         }
-        
+
+        if(modePending) applyPendingMode();
         if(sourceReader->pReader) {
             sourceReader->pReader->ReadSample(
                 MF_SOURCE_READER_FIRST_VIDEO_STREAM,
@@ -379,89 +425,89 @@ STDMETHODIMP CaptureController::OnFlush(DWORD dwStreamIndex) {
 }
 
 /*
-** Detection Thread
+** Detection
 */
-void CaptureController::startDetectionThread() {
+void CaptureController::startDetection() {
     if(detectionRunning) return;
     detectionRunning = true;
-    detectionThread = std::thread(&CaptureController::detectionWorker, this);
-    std::wcout << L"Face detection thread started" << std::endl;
+    std::wcout << L"Face detection started" << std::endl;
 }
 
-void CaptureController::stopDetectionThread() {
+void CaptureController::stopDetection() {
+    setupTasks.wait();
     detectionRunning = false;
-    queueCondition.notify_all();
-    if(detectionThread.joinable()) detectionThread.join();
-    std::wcout << L"Face detection thread stopped" << std::endl;
+    classifierRenderer.stopDetection();
+    captureModes.logMetrics();
+    framePool.logStats();
+    if(uint64_t shortFrames = frameConverter->droppedShortFrames()) {
+        std::wcout << L"Short capture buffers dropped: " << shortFrames << std::endl;
+    }
+    std::wcout << L"Face detection stopped" << std::endl;
 }
 
 /*
-** Detection Worker
+** Faces Detected
+**
+** Runs on the publish stage, once per detected frame and in order.
+** The faces are already in classifierRenderer.results by now; this
+** only tells the window, and only when they changed.
 */
-void CaptureController::detectionWorker() {
-    std::vector<Rect> prevFaces;
-
-    while(detectionRunning) {
-        std::vector<std::vector<unsigned char>> frame;
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            queueCondition.wait_for(
-                lock,
-                std::chrono::milliseconds(100),
-                [this]() {
-                    return 
-                        !frameQueue.empty() ||
-                        !detectionRunning; 
-                }
-            );
-            if(!detectionRunning) return;
-            if(!frameQueue.empty()) {
-                frame = frameQueue.front();
-                frameQueue.pop();
-            }
-        }
-        if(!frame.empty()) {
-            classifierRenderer.processFrameForFaces(frame);
-            std::vector<Rect> newFaces = classifierRenderer.getCurrentFaces();
-            {
-                std::lock_guard<std::mutex> lock(facesMutex);
-                currentDetectedFaces = newFaces;
-            }
-            if(windowManager.hwnd && newFaces != prevFaces) {
-                prevFaces = newFaces;
-                windowManager.updateOverlayWindow();
-                if(windowManager.hwnd) {
-                    PostMessage(windowManager.hwnd, WM_UPDATE_FACES, 0, 0);
-                }
-            }
+void CaptureController::onFacesDetected(const std::vector<Rect>& newFaces) {
+    if(windowManager.hwnd && newFaces != previousFaces) {
+        previousFaces = newFaces;
+        windowManager.updateOverlayWindow();
+        if(windowManager.hwnd) {
+            PostMessage(windowManager.hwnd, WM_UPDATE_FACES, 0, 0);
         }
     }
+
+    CaptureMode next;
+    if(captureModes.report(
+        classifierRenderer.getRateMetrics(),
+        classifierRenderer.qualityController.getMetrics(),
+        next
+    )) {
+        std::lock_guard<std::mutex> lock(modeMutex);
+        pendingMode = next;
+        modePending = true;
+    }
 }
 
 /*
-** Push frame to Queue
+** Capture Mode
+**
+** Switched on the reader callback, between one sample and the request
+** for the next, so no read is outstanding while the type changes. The
+** new format is read off the next sample.
 */
-void CaptureController::pushFrameToQueue(const std::vector<std::vector<unsigned char>>& frame) {
-    if(!detectionRunning || !faceDetectionEnabled) return;
+void CaptureController::applyPendingMode() {
+    CaptureMode mode;
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        if(frameQueue.size() >= 5) return;
-        frameQueue.push(frame);
+        std::lock_guard<std::mutex> lock(modeMutex);
+        mode = pendingMode;
+        modePending = false;
     }
-    queueCondition.notify_one();
+    if(sourceReader->setMode(mode)) streamFormat.reset();
+}
+
+/*
+** Publish Frame
+*/
+void CaptureController::publishFrame(const FrameHandle& frame) {
+    if(!detectionRunning || !faceDetectionEnabled) return;
+    classifierRenderer.processFrameForFaces(frame);
 }
 
 /*
 ** Get Current Faces
 */
-std::vector<Rect> CaptureController::getCurrentFaces() {
-    std::lock_guard<std::mutex> lock(facesMutex);
-    return currentDetectedFaces;
+std::vector<Rect> CaptureController::getCurrentFaces() const {
+    return classifierRenderer.getCurrentFaces();
 }
 
 void CaptureController::cleanup() {
     isRunning = false;
-    stopDetectionThread();
+    stopDetection();
 
     if(!currentDeviceId.empty()) {
         deviceController.resetCamera(currentDeviceId);
@@ -19,11 +19,15 @@
 #include <string>
 #include <vector>
 #include <queue>
+#include <memory>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
 #include "../source/source_reader.h"
 #include "../source/frame_converter.h"
+#include "../source/frame_pool.h"
+#include "../runtime/capture_modes.h"
+#include "../runtime/thread_pool.h"
 
 class D2DRenderer;
 class CaptureController : public IMFSourceReaderCallback {
@@ -33,6 +37,7 @@ class CaptureController : public IMFSourceReaderCallback {
         DeviceController deviceController;
         SourceReader* sourceReader;
         FrameConverter* frameConverter;
+        ThreadPool* threadPool;
 
         ULONG m_cRef;
         IMFMediaSource* pVideoSource;
@@ -46,18 +51,25 @@ class CaptureController : public IMFSourceReaderCallback {
         bool useD2D;
         
         CRITICAL_SECTION frameCriticalSection;
-        std::vector<std::vector<unsigned char>> currentFrame;
+        FramePool framePool;
+        FrameHandle currentFrame;
+        std::shared_ptr<const FrameFormat> streamFormat;
+        uint32_t formatRevision;
+        // Picks the capture mode and steps it down while detection keeps missing its targets
+        CaptureModeSelector captureModes;
+        std::atomic<bool> modePending{false};
+        CaptureMode pendingMode;
+        std::mutex modeMutex;
         bool frameReady;
         bool faceDetectionEnabled;
         bool isRunning;
+        // Learn a scale map when there is none on disk, and save it there once it settles
+        bool learnScaleMap;
         
-        std::thread detectionThread;
+        TaskGroup setupTasks;
         std::atomic<bool> detectionRunning{false};
-        std::queue<std::vector<std::vector<unsigned char>>> frameQueue;
-        std::mutex queueMutex;
-        std::condition_variable queueCondition;
-        std::vector<Rect> currentDetectedFaces;
-        std::mutex facesMutex;
+        // Publish stage only, to post WM_UPDATE_FACES when the faces actually change
+        std::vector<Rect> previousFaces;
 
         CaptureController(WindowManager& wm);
         ~CaptureController();
@@ -94,7 +106,7 @@ class CaptureController : public IMFSourceReaderCallback {
             return classifierRenderer;
         }
         bool setD2D();
-        void getCurrentFrame(std::vector<std::vector<unsigned char>>& frame);
+        FrameHandle getCurrentFrame();
         void cleanup();
 
         STDMETHODIMP QueryInterface(REFIID riid, void** ppv);
@@ -114,9 +126,13 @@ class CaptureController : public IMFSourceReaderCallback {
         );
         STDMETHODIMP OnFlush(DWORD dwStreamIndex);
 
-        void startDetectionThread();
-        void stopDetectionThread();
-        void detectionWorker();
-        void pushFrameToQueue(const std::vector<std::vector<unsigned char>>& frame);
-        std::vector<Rect> getCurrentFaces();
+        void startDetection();
+        void stopDetection();
+        void onFacesDetected(const std::vector<Rect>& newFaces);
+        void publishFrame(const FrameHandle& frame);
+        void applyPendingMode();
+        std::vector<Rect> getCurrentFaces() const;
+        const FaceChannel& getFaceResults() const {
+            return classifierRenderer.results;
+        }
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "cascade_kernels.h"
+#include "cpu_features.h"
+#include "kernel_registry.h"
+#include "../classifier/haar_cascade.h"
+
+#if defined(KERNELS_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+    const int LANES = 8;
+
+#if defined(KERNELS_X86)
+    /*
+    ** One rectangle sum per lane, clamped to the image as in
+    ** IntegralImage::rectSum and added up in the same order
+    */
+    struct RectSums {
+        const float* sum;
+        __m256i stride;
+        __m256i maxX;
+        __m256i maxY;
+
+        KERNEL_TARGET_AVX2 __m256 operator()(
+            __m256i x1,
+            __m256i y1,
+            __m256i x2,
+            __m256i y2
+        ) const {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i one = _mm256_set1_epi32(1);
+            x1 = _mm256_max_epi32(x1, zero);
+            y1 = _mm256_max_epi32(y1, zero);
+            x2 = _mm256_min_epi32(x2, maxX);
+            y2 = _mm256_min_epi32(y2, maxY);
+
+            __m256i top = _mm256_mullo_epi32(y1, stride);
+            __m256i bottom = _mm256_mullo_epi32(_mm256_add_epi32(y2, one), stride);
+            __m256i right = _mm256_add_epi32(x2, one);
+            __m256 bottomRight = _mm256_i32gather_ps(sum, _mm256_add_epi32(bottom, right), 4);
+            __m256 topRight = _mm256_i32gather_ps(sum, _mm256_add_epi32(top, right), 4);
+            __m256 bottomLeft = _mm256_i32gather_ps(sum, _mm256_add_epi32(bottom, x1), 4);
+            __m256 topLeft = _mm256_i32gather_ps(sum, _mm256_add_epi32(top, x1), 4);
+            return _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(bottomRight, topRight), bottomLeft), topLeft);
+        }
+    };
+
+    KERNEL_TARGET_AVX2 inline __m256i at(__m256i base, int offset) {
+        return _mm256_add_epi32(base, _mm256_set1_epi32(offset));
+    }
+
+    /*
+    ** calcFeatureValue for eight windows at one scale
+    */
+    KERNEL_TARGET_AVX2 __m256 featureValues(
+        const Feature& f,
+        const RectSums& rects,
+        __m256 x,
+        __m256 y,
+        float scale
+    ) {
+        __m256i sx = _mm256_cvttps_epi32(_mm256_add_ps(x, _mm256_set1_ps(f.x * scale)));
+        __m256i sy = _mm256_cvttps_epi32(_mm256_add_ps(y, _mm256_set1_ps(f.y * scale)));
+        int scaledW = static_cast<int>(f.width * scale);
+        int scaledH = static_cast<int>(f.height * scale);
+
+        switch(f.type) {
+            case Feature::TWO_HORIZONTAL: {
+                int halfW = scaledW / 2;
+                __m256 left = rects(sx, sy, at(sx, halfW - 1), at(sy, scaledH - 1));
+                __m256 right = rects(at(sx, halfW), sy, at(sx, scaledW - 1), at(sy, scaledH - 1));
+                return _mm256_sub_ps(left, right);
+            }
+            case Feature::TWO_VERTICAL: {
+                int halfH = scaledH / 2;
+                __m256 top = rects(sx, sy, at(sx, scaledW - 1), at(sy, halfH - 1));
+                __m256 bottom = rects(sx, at(sy, halfH), at(sx, scaledW - 1), at(sy, scaledH - 1));
+                return _mm256_sub_ps(top, bottom);
+            }
+            case Feature::THREE_HORIZONTAL: {
+                int thirdW = scaledW / 3;
+                __m256 left = rects(sx, sy, at(sx, thirdW - 1), at(sy, scaledH - 1));
+                __m256 middle = rects(at(sx, thirdW), sy, at(sx, 2 * thirdW - 1), at(sy, scaledH - 1));
+                __m256 right = rects(at(sx, 2 * thirdW), sy, at(sx, scaledW - 1), at(sy, scaledH - 1));
+                return _mm256_add_ps(_mm256_sub_ps(left, middle), right);
+            }
+            case Feature::THREE_VERTICAL: {
+                int thirdH = scaledH / 3;
+                __m256 top = rects(sx, sy, at(sx, scaledW - 1), at(sy, thirdH - 1));
+                __m256 middle = rects(sx, at(sy, thirdH), at(sx, scaledW - 1), at(sy, 2 * thirdH - 1));
+                __m256 bottom = rects(sx, at(sy, 2 * thirdH), at(sx, scaledW - 1), at(sy, scaledH - 1));
+                return _mm256_add_ps(_mm256_sub_ps(top, middle), bottom);
+            }
+            case Feature::FOUR_SQUARE: {
+                int halfW = scaledW / 2;
+                int halfH = scaledH / 2;
+                __m256 topLeft = rects(sx, sy, at(sx, halfW - 1), at(sy, halfH - 1));
+                __m256 topRight = rects(at(sx, halfW), sy, at(sx, scaledW - 1), at(sy, halfH - 1));
+                __m256 bottomLeft = rects(sx, at(sy, halfH), at(sx, halfW - 1), at(sy, scaledH - 1));
+                __m256 bottomRight = rects(at(sx, halfW), at(sy, halfH), at(sx, scaledW - 1), at(sy, scaledH - 1));
+                __m256 negated = _mm256_xor_ps(topLeft, _mm256_set1_ps(-0.0f));
+                return _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(negated, topRight), bottomLeft), bottomRight);
+            }
+        }
+        return _mm256_setzero_ps();
+    }
+
+    /*
+    ** Every stage for eight windows; returns the lanes still accepted,
+    ** starting from the lanes in `alive`
+    */
+    KERNEL_TARGET_AVX2 int evaluateLanes(
+        const HaarCascade& cascade,
+        const RectSums& rects,
+        const int* xs,
+        const int* ys,
+        float scale,
+        int alive
+    ) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs)));
+        __m256 y = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys)));
+
+        for(const auto& stage : cascade.stages) {
+            if(stage.weakClassifiers.empty()) return 0;
+            bool softCascade = stage.hasRejectionTrace();
+
+            __m256 sum = _mm256_setzero_ps();
+            for(size_t i = 0; i < stage.weakClassifiers.size(); i++) {
+                const WeakClassifier& wc = stage.weakClassifiers[i];
+                __m256 value = featureValues(wc.feature, rects, x, y, scale);
+                __m256 passed = _mm256_cmp_ps(value, _mm256_set1_ps(wc.feature.threshold), _CMP_LT_OQ);
+                __m256 vote = _mm256_blendv_ps(
+                    _mm256_set1_ps(wc.weight * wc.feature.rightVal),
+                    _mm256_set1_ps(wc.weight * wc.feature.leftVal),
+                    passed
+                );
+                sum = _mm256_add_ps(sum, vote);
+                if(softCascade) {
+                    alive &= _mm256_movemask_ps(_mm256_cmp_ps(sum, _mm256_set1_ps(stage.rejectionTrace[i]), _CMP_NLT_UQ));
+                    if(!alive) return 0;
+                }
+            }
+            alive &= _mm256_movemask_ps(_mm256_cmp_ps(sum, _mm256_set1_ps(stage.threshold), _CMP_GE_OQ));
+            if(!alive) return 0;
+        }
+        return alive;
+    }
+#endif
+}
+
+/*
+** Scalar
+*/
+void CascadeKernels::sweepBandScalar(
+    const HaarCascade& cascade,
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    size_t band,
+    std::vector<Rect>& out
+) {
+    if(band >= plan.bands.size()) return;
+
+    const WindowPlan::Band& b = plan.bands[band];
+    for(size_t i = b.begin; i < b.end; i++) {
+        const WindowPlan::Window& w = plan.windows[i];
+        const WindowPlan::Level& level = plan.levels[w.level];
+        if(cascade.evaluateWindow(integral, w.x, w.y, level.scale)) {
+            out.push_back(Rect(w.x, w.y, level.size, level.size));
+        }
+    }
+}
+
+/*
+** AVX2
+*/
+KERNEL_TARGET_AVX2 void CascadeKernels::sweepBandAVX2(
+    const HaarCascade& cascade,
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    size_t band,
+    std::vector<Rect>& out
+) {
+#if defined(KERNELS_X86)
+    if(band >= plan.bands.size() || integral.empty()) return;
+
+    RectSums rects;
+    rects.sum = integral.sum.data();
+    rects.stride = _mm256_set1_epi32(static_cast<int>(integral.stride));
+    rects.maxX = _mm256_set1_epi32(integral.width - 1);
+    rects.maxY = _mm256_set1_epi32(integral.height - 1);
+
+    const WindowPlan::Band& b = plan.bands[band];
+    int xs[LANES];
+    int ys[LANES];
+    size_t i = b.begin;
+    while(i < b.end) {
+        uint16_t levelIndex = plan.windows[i].level;
+        int count = 0;
+        while(count < LANES && i + count < b.end && plan.windows[i + count].level == levelIndex) {
+            xs[count] = plan.windows[i + count].x;
+            ys[count] = plan.windows[i + count].y;
+            count++;
+        }
+        // Short runs repeat their last window in the lanes left over, which are masked out
+        for(int lane = count; lane < LANES; lane++) {
+            xs[lane] = xs[count - 1];
+            ys[lane] = ys[count - 1];
+        }
+
+        const WindowPlan::Level& level = plan.levels[levelIndex];
+        int accepted = evaluateLanes(cascade, rects, xs, ys, level.scale, (1 << count) - 1);
+        for(int lane = 0; lane < count; lane++) {
+            if(accepted & (1 << lane)) out.push_back(Rect(xs[lane], ys[lane], level.size, level.size));
+        }
+        i += count;
+    }
+#else
+    sweepBandScalar(cascade, integral, plan, band, out);
+#endif
+}
+
+/*
+** Dispatch
+*/
+void CascadeKernels::sweepBand(
+    const HaarCascade& cascade,
+    const IntegralImage& integral,
+    const WindowPlan& plan,
+    size_t band,
+    std::vector<Rect>& out
+) {
+    KernelRegistry::get().stageSweep.fn(cascade, integral, plan, band, out);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "../classifier/integral_image.h"
+#include "../classifier/rect.h"
+#include "../classifier/window_plan.h"
+
+class HaarCascade;
+
+/*
+** Cascade sweeps over one band of a WindowPlan, appending every window
+** the cascade accepts in plan order. The AVX2 sweep takes up to eight
+** consecutive windows of the same level side by side, gathering the
+** rectangle corners, and moves on once every lane is rejected. Each
+** lane does the scalar arithmetic in the scalar order, so both accept
+** the same windows. The unsuffixed entry point calls whatever
+** KernelRegistry bound.
+*/
+class CascadeKernels {
+    public:
+        static void sweepBand(
+            const HaarCascade& cascade,
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            size_t band,
+            std::vector<Rect>& out
+        );
+
+        static void sweepBandScalar(
+            const HaarCascade& cascade,
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            size_t band,
+            std::vector<Rect>& out
+        );
+        static void sweepBandAVX2(
+            const HaarCascade& cascade,
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            size_t band,
+            std::vector<Rect>& out
+        );
+};
@@ -0,0 +1,68 @@
+#include "cpu_features.h"
+
+#if defined(KERNELS_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+#if defined(KERNELS_X86)
+    void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, leaf, subleaf);
+        for(int i = 0; i < 4; i++) regs[i] = static_cast<unsigned int>(info[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    unsigned long long xgetbv() {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned int eax = 0;
+        unsigned int edx = 0;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    CpuFeatures detect() {
+        CpuFeatures f;
+#if defined(KERNELS_X86)
+        unsigned int regs[4] = {0, 0, 0, 0};
+        cpuid(0, 0, regs);
+        unsigned int maxLeaf = regs[0];
+
+        cpuid(1, 0, regs);
+        f.sse2 = (regs[3] & (1u << 26)) != 0;
+        f.ssse3 = (regs[2] & (1u << 9)) != 0;
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0;
+
+        // The OS must save YMM (and ZMM) state for the wider paths to be usable
+        unsigned long long xcr0 = osxsave ? xgetbv() : 0;
+        bool ymm = (xcr0 & 0x6) == 0x6;
+        bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+        if(maxLeaf >= 7) {
+            cpuid(7, 0, regs);
+            f.avx2 = avx && ymm && (regs[1] & (1u << 5)) != 0;
+            bool avx512f = (regs[1] & (1u << 16)) != 0;
+            bool avx512bw = (regs[1] & (1u << 30)) != 0;
+            f.avx512 = f.avx2 && zmm && avx512f && avx512bw;
+        }
+#endif
+        return f;
+    }
+}
+
+const CpuFeatures& CpuFeatures::get() {
+    static const CpuFeatures features = detect();
+    return features;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86 1
+#endif
+
+#if defined(KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KERNEL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#define KERNEL_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define KERNEL_TARGET_SSSE3
+#define KERNEL_TARGET_AVX2
+#define KERNEL_TARGET_AVX512
+#endif
+
+struct CpuFeatures {
+    bool sse2;
+    bool ssse3;
+    bool avx2;
+    bool avx512;
+
+    CpuFeatures() :
+        sse2(false),
+        ssse3(false),
+        avx2(false),
+        avx512(false) {}
+
+    static const CpuFeatures& get();
+};
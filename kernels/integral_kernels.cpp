@@ -0,0 +1,432 @@
+#include "integral_kernels.h"
+#include "cpu_features.h"
+#include "kernel_registry.h"
+#include "../runtime/thread_pool.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(KERNELS_X86)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    struct GrayLuma {
+        static uint8_t at(const uint8_t* row, int x) {
+            return row[x];
+        }
+    };
+    struct YUY2Luma {
+        static uint8_t at(const uint8_t* row, int x) {
+            return row[x * 2];
+        }
+    };
+    struct BGRALuma {
+        // 0.299, 0.587 and 0.114 in Q16
+        static uint8_t at(const uint8_t* row, int x) {
+            const uint8_t* p = row + x * 4;
+            return static_cast<uint8_t>((7471 * p[0] + 38470 * p[1] + 19595 * p[2]) >> 16);
+        }
+    };
+
+    template<typename Luma>
+    const uint8_t* lumaRow(
+        const uint8_t* row,
+        int width,
+        std::vector<uint8_t>& scratch
+    ) {
+        for(int x = 0; x < width; x++) scratch[x] = Luma::at(row, x);
+        return scratch.data();
+    }
+
+    template<>
+    const uint8_t* lumaRow<GrayLuma>(
+        const uint8_t* row,
+        int,
+        std::vector<uint8_t>&
+    ) {
+        return row;
+    }
+
+    /*
+    ** Luma of `count` source rows from `first` on, `stride` apart. A gray
+    ** plane is read in place; other formats are unpacked into scratch.
+    */
+    template<typename Luma>
+    const uint8_t* lumaRows(
+        const uint8_t* src,
+        size_t srcStride,
+        int first,
+        int count,
+        int width,
+        std::vector<uint8_t>& scratch,
+        size_t& stride
+    ) {
+        stride = width;
+        scratch.resize(static_cast<size_t>(count) * width);
+        for(int r = 0; r < count; r++) {
+            const uint8_t* row = src + (first + r) * srcStride;
+            for(int x = 0; x < width; x++) scratch[r * stride + x] = Luma::at(row, x);
+        }
+        return scratch.data();
+    }
+
+    template<>
+    const uint8_t* lumaRows<GrayLuma>(
+        const uint8_t* src,
+        size_t srcStride,
+        int first,
+        int,
+        int,
+        std::vector<uint8_t>&,
+        size_t& stride
+    ) {
+        stride = srcStride;
+        return src + first * srcStride;
+    }
+
+    /*
+    ** Append one luma row to the integral. The row stays in L1 between
+    ** extraction and accumulation, so the source is still read once.
+    ** `above` is the previous integral row, or zeros at the top of a tile.
+    */
+    void accumulateRow(
+        const uint8_t* luma,
+        int width,
+        int y,
+        const float* above,
+        const double* aboveSq,
+        IntegralImage& out,
+        bool squared,
+        KernelRegistry::IntegralRowFn integralRow
+    ) {
+        size_t stride = out.stride;
+        float* current = out.sum.data() + (y + 1) * stride;
+        current[0] = 0.0f;
+        integralRow(luma, above + 1, current + 1, width);
+
+        if(squared) {
+            double* currentSq = out.squared.data() + (y + 1) * stride;
+            currentSq[0] = 0.0;
+
+            double rowSq = 0;
+            for(int x = 0; x < width; x++) {
+                rowSq += static_cast<double>(luma[x]) * luma[x];
+                currentSq[x + 1] = aboveSq[x + 1] + rowSq;
+            }
+        }
+    }
+
+    /*
+    ** Output rows [rowBegin, rowEnd) of the integral, accumulated as if
+    ** the row above rowBegin were zero. A decimation of 2 goes through
+    ** the bound 2x downscale, and 4 through it twice, which rounds twice
+    ** and so can land one level off the exact 4x4 mean. Any other
+    ** decimation takes the rounded box mean through a column accumulator.
+    */
+    template<typename Luma>
+    void buildRows(
+        const uint8_t* src,
+        size_t srcStride,
+        int decimation,
+        int rowBegin,
+        int rowEnd,
+        IntegralImage& out,
+        bool squared
+    ) {
+        int width = out.width;
+        uint32_t area = static_cast<uint32_t>(decimation * decimation);
+
+        thread_local std::vector<uint8_t> scratch;
+        thread_local std::vector<uint8_t> sourceRows;
+        thread_local std::vector<uint8_t> halves;
+        thread_local std::vector<uint32_t> columns;
+        thread_local std::vector<float> zeros;
+        thread_local std::vector<double> zerosSq;
+        scratch.resize(width);
+        zeros.assign(out.stride, 0.0f);
+        if(squared) zerosSq.assign(out.stride, 0.0);
+        bool halving = decimation == 2 || decimation == 4;
+        if(decimation == 4) halves.resize(static_cast<size_t>(width) * 4);
+        if(decimation > 1 && !halving) columns.resize(width);
+        KernelRegistry::IntegralRowFn integralRow = KernelRegistry::get().integralRow.fn;
+        KernelRegistry::DownscaleFn downscale2x = KernelRegistry::get().downscale2x.fn;
+
+        for(int y = rowBegin; y < rowEnd; y++) {
+            const uint8_t* luma = nullptr;
+            if(decimation <= 1) {
+                luma = lumaRow<Luma>(src + y * srcStride, width, scratch);
+            } else if(halving) {
+                size_t stride = 0;
+                const uint8_t* rows = lumaRows<Luma>(src, srcStride, y * decimation, decimation, width * decimation, sourceRows, stride);
+                if(decimation == 4) {
+                    downscale2x(rows, stride, halves.data(), width * 2, width * 2, 2);
+                    rows = halves.data();
+                    stride = width * 2;
+                }
+                downscale2x(rows, stride, scratch.data(), width, width, 1);
+                luma = scratch.data();
+            } else {
+                std::fill(columns.begin(), columns.end(), 0u);
+                for(int r = 0; r < decimation; r++) {
+                    const uint8_t* row = src + (y * decimation + r) * srcStride;
+                    for(int x = 0; x < width; x++) {
+                        uint32_t acc = 0;
+                        for(int k = 0; k < decimation; k++) acc += Luma::at(row, x * decimation + k);
+                        columns[x] += acc;
+                    }
+                }
+                for(int x = 0; x < width; x++) {
+                    scratch[x] = static_cast<uint8_t>((columns[x] + area / 2) / area);
+                }
+                luma = scratch.data();
+            }
+
+            bool first = y == rowBegin;
+            const float* above = first ? zeros.data() : out.sum.data() + y * out.stride;
+            const double* aboveSq = nullptr;
+            if(squared) aboveSq = first ? zerosSq.data() : out.squared.data() + y * out.stride;
+            accumulateRow(luma, width, y, above, aboveSq, out, squared, integralRow);
+        }
+    }
+
+    /*
+    ** Two-pass parallel prefix over row tiles: every tile first builds
+    ** its own integral from a zero row, then each tile gets the running
+    ** total of the last rows of all tiles above it added back in.
+    */
+    template<typename Luma>
+    void buildTiled(
+        const uint8_t* src,
+        size_t srcStride,
+        int decimation,
+        IntegralImage& out,
+        bool squared,
+        ThreadPool& pool
+    ) {
+        int height = out.height;
+        size_t stride = out.stride;
+        int tiles = static_cast<int>((std::min)(pool.size() * 2, static_cast<size_t>(height)));
+        int tileRows = (height + tiles - 1) / tiles;
+        tiles = (height + tileRows - 1) / tileRows;
+
+        pool.parallelFor(tiles, [&](size_t t) {
+            int begin = static_cast<int>(t) * tileRows;
+            buildRows<Luma>(src, srcStride, decimation, begin, (std::min)(height, begin + tileRows), out, squared);
+        });
+
+        // Carry for tile t is the sum of the local last rows of tiles 0..t-1
+        std::vector<float> carries(tiles * stride, 0.0f);
+        std::vector<double> carriesSq(squared ? tiles * stride : 0, 0.0);
+        for(int t = 1; t < tiles; t++) {
+            const float* last = out.sum.data() + (t * tileRows) * stride;
+            const float* previous = carries.data() + (t - 1) * stride;
+            float* carry = carries.data() + t * stride;
+            for(size_t x = 0; x < stride; x++) carry[x] = previous[x] + last[x];
+            if(squared) {
+                const double* lastSq = out.squared.data() + (t * tileRows) * stride;
+                const double* previousSq = carriesSq.data() + (t - 1) * stride;
+                double* carrySq = carriesSq.data() + t * stride;
+                for(size_t x = 0; x < stride; x++) carrySq[x] = previousSq[x] + lastSq[x];
+            }
+        }
+
+        if(tiles < 2) return;
+        pool.parallelFor(tiles - 1, [&](size_t i) {
+            int t = static_cast<int>(i) + 1;
+            int begin = t * tileRows;
+            int end = (std::min)(height, begin + tileRows);
+            const float* carry = carries.data() + t * stride;
+            const double* carrySq = squared ? carriesSq.data() + t * stride : nullptr;
+            for(int y = begin; y < end; y++) {
+                float* row = out.sum.data() + (y + 1) * stride;
+                for(size_t x = 0; x < stride; x++) row[x] += carry[x];
+                if(squared) {
+                    double* rowSq = out.squared.data() + (y + 1) * stride;
+                    for(size_t x = 0; x < stride; x++) rowSq[x] += carrySq[x];
+                }
+            }
+        });
+    }
+
+    template<typename Luma>
+    void build(
+        const uint8_t* src,
+        size_t srcStride,
+        int width,
+        int height,
+        int decimation,
+        IntegralImage& out,
+        bool squared,
+        ThreadPool* pool
+    ) {
+        decimation = (std::max)(decimation, 1);
+        out.resize(width / decimation, height / decimation, squared);
+        if(out.empty()) return;
+
+        if(pool && pool->size() > 1 && out.height > 1) {
+            buildTiled<Luma>(src, srcStride, decimation, out, squared, *pool);
+        } else {
+            buildRows<Luma>(src, srcStride, decimation, 0, out.height, out, squared);
+        }
+    }
+
+    template<typename Luma>
+    void extractGray(
+        const uint8_t* src,
+        size_t srcStride,
+        uint8_t* dst,
+        size_t dstStride,
+        int width,
+        int height
+    ) {
+        for(int y = 0; y < height; y++) {
+            const uint8_t* row = src + y * srcStride;
+            uint8_t* out = dst + y * dstStride;
+            for(int x = 0; x < width; x++) {
+                out[x] = Luma::at(row, x);
+            }
+        }
+    }
+}
+
+/*
+** Integral Row
+*/
+void IntegralKernels::integralRowScalar(
+    const uint8_t* luma,
+    const float* above,
+    float* current,
+    int width
+) {
+    float rowSum = 0;
+    for(int x = 0; x < width; x++) {
+        rowSum += luma[x];
+        current[x] = above[x] + rowSum;
+    }
+}
+
+/*
+** SSE2, in-register prefix sum over 4 lanes. Row sums stay below 2^24,
+** so they are exact in float and the result matches the scalar path.
+*/
+void IntegralKernels::integralRowSSE2(
+    const uint8_t* luma,
+    const float* above,
+    float* current,
+    int width
+) {
+#if defined(KERNELS_X86)
+    const __m128i zero = _mm_setzero_si128();
+    __m128 carry = _mm_setzero_ps();
+
+    int x = 0;
+    for(; x + 16 <= width; x += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(luma + x));
+        __m128i words[2] = {
+            _mm_unpacklo_epi8(bytes, zero),
+            _mm_unpackhi_epi8(bytes, zero)
+        };
+        for(int w = 0; w < 2; w++) {
+            __m128i quads[2] = {
+                _mm_unpacklo_epi16(words[w], zero),
+                _mm_unpackhi_epi16(words[w], zero)
+            };
+            for(int q = 0; q < 2; q++) {
+                __m128i v = quads[q];
+                v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+                v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+                __m128 prefix = _mm_add_ps(_mm_cvtepi32_ps(v), carry);
+                carry = _mm_shuffle_ps(prefix, prefix, _MM_SHUFFLE(3, 3, 3, 3));
+
+                int offset = x + w * 8 + q * 4;
+                _mm_storeu_ps(current + offset, _mm_add_ps(_mm_loadu_ps(above + offset), prefix));
+            }
+        }
+    }
+
+    float rowSum = _mm_cvtss_f32(carry);
+    for(; x < width; x++) {
+        rowSum += luma[x];
+        current[x] = above[x] + rowSum;
+    }
+#else
+    integralRowScalar(luma, above, current, width);
+#endif
+}
+
+/*
+** Integral
+*/
+void IntegralKernels::fromGray(
+    const uint8_t* src,
+    size_t srcStride,
+    int width,
+    int height,
+    IntegralImage& out,
+    bool squared,
+    int decimation,
+    ThreadPool* pool
+) {
+    build<GrayLuma>(src, srcStride, width, height, decimation, out, squared, pool);
+}
+
+void IntegralKernels::fromPlane(
+    const PlaneView& plane,
+    IntegralImage& out,
+    bool squared,
+    int decimation,
+    ThreadPool* pool
+) {
+    build<GrayLuma>(plane.data, plane.stride, plane.width, plane.height, decimation, out, squared, pool);
+}
+
+void IntegralKernels::fromYUY2(
+    const uint8_t* src,
+    size_t srcStride,
+    int width,
+    int height,
+    IntegralImage& out,
+    bool squared,
+    int decimation,
+    ThreadPool* pool
+) {
+    build<YUY2Luma>(src, srcStride, width, height, decimation, out, squared, pool);
+}
+
+void IntegralKernels::fromBGRA(
+    const uint8_t* src,
+    size_t srcStride,
+    int width,
+    int height,
+    IntegralImage& out,
+    bool squared,
+    int decimation,
+    ThreadPool* pool
+) {
+    build<BGRALuma>(src, srcStride, width, height, decimation, out, squared, pool);
+}
+
+/*
+** Grayscale
+*/
+void IntegralKernels::grayFromYUY2(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    extractGray<YUY2Luma>(src, srcStride, dst, dstStride, width, height);
+}
+
+void IntegralKernels::grayFromBGRA(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    extractGray<BGRALuma>(src, srcStride, dst, dstStride, width, height);
+}
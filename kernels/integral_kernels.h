@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "../classifier/integral_image.h"
+#include "../source/frame.h"
+
+class ThreadPool;
+
+/*
+** Single-pass luma extraction fused with the integral (and optionally
+** squared integral) image. The source is read once and no grayscale
+** frame is materialized. A decimation of 2 or 4 box-filters the luma
+** down in the same pass, through the bound 2x downscale kernel, so the
+** integral covers width / decimation by height / decimation pixels.
+** Given a pool, rows are split into tiles and joined with a two-pass
+** prefix; the caller decides when a frame is large enough to be worth
+** it.
+*/
+class IntegralKernels {
+    public:
+        static void fromGray(
+            const uint8_t* src,
+            size_t srcStride,
+            int width,
+            int height,
+            IntegralImage& out,
+            bool squared,
+            int decimation = 1,
+            ThreadPool* pool = nullptr
+        );
+        static void fromPlane(
+            const PlaneView& plane,
+            IntegralImage& out,
+            bool squared,
+            int decimation = 1,
+            ThreadPool* pool = nullptr
+        );
+        static void fromYUY2(
+            const uint8_t* src,
+            size_t srcStride,
+            int width,
+            int height,
+            IntegralImage& out,
+            bool squared,
+            int decimation = 1,
+            ThreadPool* pool = nullptr
+        );
+        static void fromBGRA(
+            const uint8_t* src,
+            size_t srcStride,
+            int width,
+            int height,
+            IntegralImage& out,
+            bool squared,
+            int decimation = 1,
+            ThreadPool* pool = nullptr
+        );
+
+        static void grayFromYUY2(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        static void grayFromBGRA(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+
+        /*
+        ** current[x] = above[x] + luma[0] + ... + luma[x]
+        */
+        static void integralRowScalar(
+            const uint8_t* luma,
+            const float* above,
+            float* current,
+            int width
+        );
+        static void integralRowSSE2(
+            const uint8_t* luma,
+            const float* above,
+            float* current,
+            int width
+        );
+};
@@ -0,0 +1,143 @@
+#include "kernel_registry.h"
+#include "cpu_features.h"
+#include "pixel_kernels.h"
+#include "integral_kernels.h"
+#include "cascade_kernels.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+    KernelLevel detectLevel() {
+        const CpuFeatures& cpu = CpuFeatures::get();
+        if(cpu.avx512) return KernelLevel::AVX512;
+        if(cpu.avx2) return KernelLevel::AVX2;
+        if(cpu.ssse3) return KernelLevel::SSSE3;
+        if(cpu.sse2) return KernelLevel::SSE2;
+        return KernelLevel::Scalar;
+    }
+
+    bool parseLevel(const char* text, KernelLevel& level) {
+        std::string name(text);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        if(name == "scalar") level = KernelLevel::Scalar;
+        else if(name == "sse2") level = KernelLevel::SSE2;
+        else if(name == "ssse3") level = KernelLevel::SSSE3;
+        else if(name == "avx2") level = KernelLevel::AVX2;
+        else if(name == "avx512") level = KernelLevel::AVX512;
+        else return false;
+        return true;
+    }
+
+    /*
+    ** Bind the highest variant at or below the usable level. Variants are
+    ** listed from best to worst and the last one is always scalar.
+    */
+    template<typename Fn>
+    KernelRegistry::Entry<Fn> bind(
+        KernelLevel usable,
+        std::initializer_list<KernelRegistry::Entry<Fn>> variants
+    ) {
+        for(const auto& variant : variants) {
+            if(variant.level <= usable) return variant;
+        }
+        return *(variants.end() - 1);
+    }
+}
+
+const wchar_t* kernelLevelName(KernelLevel level) {
+    switch(level) {
+        case KernelLevel::SSE2: return L"sse2";
+        case KernelLevel::SSSE3: return L"ssse3";
+        case KernelLevel::AVX2: return L"avx2";
+        case KernelLevel::AVX512: return L"avx512";
+        default: return L"scalar";
+    }
+}
+
+KernelRegistry::KernelRegistry() :
+    cpuLevel(detectLevel()),
+    cap(KernelLevel::AVX512),
+    overridden(false)
+{
+    const char* env = std::getenv("CAMVALLEY_KERNELS");
+    if(env && *env) {
+        if(parseLevel(env, cap)) {
+            overridden = true;
+        } else {
+            std::wcout << L"Ignoring unknown CAMVALLEY_KERNELS value: " << env << std::endl;
+        }
+    }
+    KernelLevel usable = (std::min)(cpuLevel, cap);
+
+    yuy2ToBgra = bind<Yuy2ToBgraFn>(usable, {
+        {PixelKernels::yuy2ToBgraAVX2, KernelLevel::AVX2},
+        {PixelKernels::yuy2ToBgraSSE2, KernelLevel::SSE2},
+        {PixelKernels::yuy2ToBgraScalar, KernelLevel::Scalar}
+    });
+    nv12ToBgra = bind<Nv12ToBgraFn>(usable, {
+        {PixelKernels::nv12ToBgraAVX2, KernelLevel::AVX2},
+        {PixelKernels::nv12ToBgraSSE2, KernelLevel::SSE2},
+        {PixelKernels::nv12ToBgraScalar, KernelLevel::Scalar}
+    });
+    integralRow = bind<IntegralRowFn>(usable, {
+        {IntegralKernels::integralRowSSE2, KernelLevel::SSE2},
+        {IntegralKernels::integralRowScalar, KernelLevel::Scalar}
+    });
+    downscale2x = bind<DownscaleFn>(usable, {
+        {PixelKernels::downscale2xSSE2, KernelLevel::SSE2},
+        {PixelKernels::downscale2xScalar, KernelLevel::Scalar}
+    });
+    blockDiff = bind<BlockDiffFn>(usable, {
+        {PixelKernels::blockDiffAVX2, KernelLevel::AVX2},
+        {PixelKernels::blockDiffSSE2, KernelLevel::SSE2},
+        {PixelKernels::blockDiffScalar, KernelLevel::Scalar}
+    });
+    stageSweep = bind<StageSweepFn>(usable, {
+        {CascadeKernels::sweepBandAVX2, KernelLevel::AVX2},
+        {CascadeKernels::sweepBandScalar, KernelLevel::Scalar}
+    });
+
+    std::wcout << report() << std::endl;
+}
+
+const KernelRegistry& KernelRegistry::get() {
+    static const KernelRegistry registry;
+    return registry;
+}
+
+/*
+** Report
+*/
+std::wstring KernelRegistry::report() const {
+    std::wostringstream line;
+    line << L"Kernels: cpu=" << kernelLevelName(cpuLevel);
+    if(overridden) line << L" cap=" << kernelLevelName(cap);
+    line << L" yuy2ToBgra=" << kernelLevelName(yuy2ToBgra.level)
+         << L" nv12ToBgra=" << kernelLevelName(nv12ToBgra.level)
+         << L" integralRow=" << kernelLevelName(integralRow.level)
+         << L" downscale2x=" << kernelLevelName(downscale2x.level)
+         << L" blockDiff=" << kernelLevelName(blockDiff.level)
+         << L" stageSweep=" << kernelLevelName(stageSweep.level);
+
+    // Tiers the CPU offers that no kernel is bound at yet
+    KernelLevel bound[] = {
+        yuy2ToBgra.level, nv12ToBgra.level, integralRow.level,
+        downscale2x.level, blockDiff.level, stageSweep.level
+    };
+    KernelLevel usable = (std::min)(cpuLevel, cap);
+    std::wstring idle;
+    for(KernelLevel level : {KernelLevel::SSE2, KernelLevel::SSSE3, KernelLevel::AVX2, KernelLevel::AVX512}) {
+        if(level > usable) break;
+        if(std::find(std::begin(bound), std::end(bound), level) != std::end(bound)) continue;
+        if(!idle.empty()) idle += L",";
+        idle += kernelLevelName(level);
+    }
+    if(!idle.empty()) line << L" idle=" << idle;
+    return line.str();
+}
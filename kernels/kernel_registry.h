@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class HaarCascade;
+class IntegralImage;
+class WindowPlan;
+class Rect;
+
+enum class KernelLevel {
+    Scalar,
+    SSE2,
+    SSSE3,
+    AVX2,
+    AVX512
+};
+
+const wchar_t* kernelLevelName(KernelLevel level);
+
+/*
+** One function pointer per hot kernel, bound once at startup to the
+** best variant the CPU supports. CAMVALLEY_KERNELS=scalar|sse2|ssse3|
+** avx2|avx512 caps the level so paths can be compared on one machine.
+*/
+class KernelRegistry {
+    public:
+        typedef void (*Yuy2ToBgraFn)(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        typedef void (*Nv12ToBgraFn)(
+            const uint8_t* srcY,
+            size_t strideY,
+            const uint8_t* srcUV,
+            size_t strideUV,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        typedef void (*IntegralRowFn)(
+            const uint8_t* luma,
+            const float* above,
+            float* current,
+            int width
+        );
+        typedef void (*DownscaleFn)(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int dstWidth,
+            int dstHeight
+        );
+        typedef uint32_t (*BlockDiffFn)(
+            const uint8_t* a,
+            size_t strideA,
+            const uint8_t* b,
+            size_t strideB,
+            int width,
+            int height
+        );
+        typedef void (*StageSweepFn)(
+            const HaarCascade& cascade,
+            const IntegralImage& integral,
+            const WindowPlan& plan,
+            size_t band,
+            std::vector<Rect>& out
+        );
+
+        template<typename Fn>
+        struct Entry {
+            Fn fn;
+            KernelLevel level;
+        };
+
+        Entry<Yuy2ToBgraFn> yuy2ToBgra;
+        Entry<Nv12ToBgraFn> nv12ToBgra;
+        Entry<IntegralRowFn> integralRow;
+        Entry<DownscaleFn> downscale2x;
+        Entry<BlockDiffFn> blockDiff;
+        Entry<StageSweepFn> stageSweep;
+
+        KernelLevel cpuLevel;
+        KernelLevel cap;
+        bool overridden;
+
+        static const KernelRegistry& get();
+        std::wstring report() const;
+
+    private:
+        KernelRegistry();
+};
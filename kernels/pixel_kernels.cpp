@@ -0,0 +1,611 @@
+#include "pixel_kernels.h"
+#include "cpu_features.h"
+#include "kernel_registry.h"
+
+#if defined(KERNELS_X86)
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+    // 1.402, 0.344, 0.714 and 1.772 in Q10
+    const int COEF_RV = 1436;
+    const int COEF_GU = 352;
+    const int COEF_GV = 731;
+    const int COEF_BU = 1815;
+
+    inline uint8_t clamp8(int v) {
+        return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+    }
+
+    inline void yuy2ToBgraRow(
+        const uint8_t* src,
+        uint8_t* dst,
+        int from,
+        int width
+    ) {
+        for(int x = from; x < width; x += 2) {
+            const uint8_t* p = src + x * 2;
+            int u = p[1] - 128;
+            int v = p[3] - 128;
+            int dr = (COEF_RV * v) >> 10;
+            int dg = ((COEF_GU * u) >> 10) + ((COEF_GV * v) >> 10);
+            int db = (COEF_BU * u) >> 10;
+
+            uint8_t* out = dst + x * 4;
+            int y0 = p[0];
+            out[0] = clamp8(y0 + db);
+            out[1] = clamp8(y0 - dg);
+            out[2] = clamp8(y0 + dr);
+            out[3] = 255;
+
+            if(x + 1 < width) {
+                int y1 = p[2];
+                out[4] = clamp8(y1 + db);
+                out[5] = clamp8(y1 - dg);
+                out[6] = clamp8(y1 + dr);
+                out[7] = 255;
+            }
+        }
+    }
+
+    inline void nv12ToBgraRow(
+        const uint8_t* srcY,
+        const uint8_t* srcUV,
+        uint8_t* dst,
+        int from,
+        int width
+    ) {
+        for(int x = from; x < width; x++) {
+            const uint8_t* p = srcUV + (x & ~1);
+            int u = p[0] - 128;
+            int v = p[1] - 128;
+            int dr = (COEF_RV * v) >> 10;
+            int dg = ((COEF_GU * u) >> 10) + ((COEF_GV * v) >> 10);
+            int db = (COEF_BU * u) >> 10;
+
+            uint8_t* out = dst + x * 4;
+            int y = srcY[x];
+            out[0] = clamp8(y + db);
+            out[1] = clamp8(y - dg);
+            out[2] = clamp8(y + dr);
+            out[3] = 255;
+        }
+    }
+
+    inline void downscale2xRow(
+        const uint8_t* top,
+        size_t srcStride,
+        uint8_t* dst,
+        int from,
+        int dstWidth
+    ) {
+        const uint8_t* bottom = top + srcStride;
+        for(int x = from; x < dstWidth; x++) {
+            int sum = top[x * 2] + top[x * 2 + 1] + bottom[x * 2] + bottom[x * 2 + 1];
+            dst[x] = static_cast<uint8_t>((sum + 2) >> 2);
+        }
+    }
+
+    inline uint32_t blockDiffRow(
+        const uint8_t* a,
+        const uint8_t* b,
+        int from,
+        int width
+    ) {
+        uint32_t total = 0;
+        for(int x = from; x < width; x++) {
+            total += a[x] > b[x] ? a[x] - b[x] : b[x] - a[x];
+        }
+        return total;
+    }
+
+#if defined(KERNELS_X86)
+    /*
+    ** 16-bit Y plus pre-shifted (c - 128) << 6 chroma to B, G, R lanes
+    */
+    inline void yuvConvert8(
+        __m128i y,
+        __m128i u,
+        __m128i v,
+        __m128i& r,
+        __m128i& g,
+        __m128i& b
+    ) {
+        // (c << 6) * coef >> 16 == c * coef >> 10, same rounding as the scalar path
+        r = _mm_add_epi16(y, _mm_mulhi_epi16(v, _mm_set1_epi16(COEF_RV)));
+        g = _mm_sub_epi16(
+            _mm_sub_epi16(y, _mm_mulhi_epi16(u, _mm_set1_epi16(COEF_GU))),
+            _mm_mulhi_epi16(v, _mm_set1_epi16(COEF_GV))
+        );
+        b = _mm_add_epi16(y, _mm_mulhi_epi16(u, _mm_set1_epi16(COEF_BU)));
+    }
+
+    /*
+    ** Two halves of 8 pixels packed and interleaved into 16 BGRA pixels
+    */
+    inline void storeBgra16(
+        uint8_t* dst,
+        __m128i r0,
+        __m128i g0,
+        __m128i b0,
+        __m128i r1,
+        __m128i g1,
+        __m128i b1
+    ) {
+        const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+        __m128i r = _mm_packus_epi16(r0, r1);
+        __m128i g = _mm_packus_epi16(g0, g1);
+        __m128i b = _mm_packus_epi16(b0, b1);
+
+        __m128i bgLo = _mm_unpacklo_epi8(b, g);
+        __m128i bgHi = _mm_unpackhi_epi8(b, g);
+        __m128i raLo = _mm_unpacklo_epi8(r, alpha);
+        __m128i raHi = _mm_unpackhi_epi8(r, alpha);
+
+        __m128i* out = reinterpret_cast<__m128i*>(dst);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(bgLo, raLo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bgLo, raLo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bgHi, raHi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bgHi, raHi));
+    }
+
+    /*
+    ** 8 YUY2 pixels to 16-bit B, G, R lanes
+    */
+    inline void yuy2Convert8(
+        __m128i p,
+        __m128i& r,
+        __m128i& g,
+        __m128i& b
+    ) {
+        const __m128i lowByte = _mm_set1_epi16(0x00FF);
+        const __m128i bias = _mm_set1_epi16(128);
+
+        __m128i y = _mm_and_si128(p, lowByte);
+        __m128i uv = _mm_slli_epi16(_mm_sub_epi16(_mm_srli_epi16(p, 8), bias), 6);
+        __m128i u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m128i v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+        yuvConvert8(y, u, v, r, g, b);
+    }
+
+    KERNEL_TARGET_AVX2 inline void yuy2Convert16(
+        __m256i p,
+        __m256i& r,
+        __m256i& g,
+        __m256i& b
+    ) {
+        const __m256i lowByte = _mm256_set1_epi16(0x00FF);
+        const __m256i bias = _mm256_set1_epi16(128);
+
+        __m256i y = _mm256_and_si256(p, lowByte);
+        __m256i uv = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_srli_epi16(p, 8), bias), 6);
+        __m256i u = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+        __m256i v = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(uv, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+        r = _mm256_add_epi16(y, _mm256_mulhi_epi16(v, _mm256_set1_epi16(COEF_RV)));
+        g = _mm256_sub_epi16(
+            _mm256_sub_epi16(y, _mm256_mulhi_epi16(u, _mm256_set1_epi16(COEF_GU))),
+            _mm256_mulhi_epi16(v, _mm256_set1_epi16(COEF_GV))
+        );
+        b = _mm256_add_epi16(y, _mm256_mulhi_epi16(u, _mm256_set1_epi16(COEF_BU)));
+    }
+#endif
+}
+
+/*
+** Scalar Reference
+*/
+void PixelKernels::yuy2ToBgraScalar(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    for(int y = 0; y < height; y++) {
+        yuy2ToBgraRow(src + y * srcStride, dst + y * dstStride, 0, width);
+    }
+}
+
+/*
+** SSE2, 16 pixels per iteration
+*/
+void PixelKernels::yuy2ToBgraSSE2(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    for(int y = 0; y < height; y++) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        int x = 0;
+        for(; x + 16 <= width; x += 16) {
+            __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + x * 2));
+            __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow + x * 2 + 16));
+
+            __m128i r0, g0, b0, r1, g1, b1;
+            yuy2Convert8(p0, r0, g0, b0);
+            yuy2Convert8(p1, r1, g1, b1);
+            storeBgra16(dstRow + x * 4, r0, g0, b0, r1, g1, b1);
+        }
+        yuy2ToBgraRow(srcRow, dstRow, x, width);
+    }
+#else
+    yuy2ToBgraScalar(src, srcStride, dst, dstStride, width, height);
+#endif
+}
+
+/*
+** AVX2, 32 pixels per iteration
+*/
+KERNEL_TARGET_AVX2 void PixelKernels::yuy2ToBgraAVX2(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    const __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    for(int y = 0; y < height; y++) {
+        const uint8_t* srcRow = src + y * srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        int x = 0;
+        for(; x + 32 <= width; x += 32) {
+            __m256i p0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + x * 2));
+            __m256i p1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcRow + x * 2 + 32));
+
+            __m256i r0, g0, b0, r1, g1, b1;
+            yuy2Convert16(p0, r0, g0, b0);
+            yuy2Convert16(p1, r1, g1, b1);
+
+            // Packing is per 128-bit lane: lane 0 holds pixels 0-7 and 16-23, lane 1 holds 8-15 and 24-31
+            __m256i r = _mm256_packus_epi16(r0, r1);
+            __m256i g = _mm256_packus_epi16(g0, g1);
+            __m256i b = _mm256_packus_epi16(b0, b1);
+
+            __m256i bgLo = _mm256_unpacklo_epi8(b, g);
+            __m256i bgHi = _mm256_unpackhi_epi8(b, g);
+            __m256i raLo = _mm256_unpacklo_epi8(r, alpha);
+            __m256i raHi = _mm256_unpackhi_epi8(r, alpha);
+
+            __m256i q0 = _mm256_unpacklo_epi16(bgLo, raLo);
+            __m256i q1 = _mm256_unpackhi_epi16(bgLo, raLo);
+            __m256i q2 = _mm256_unpacklo_epi16(bgHi, raHi);
+            __m256i q3 = _mm256_unpackhi_epi16(bgHi, raHi);
+
+            __m256i* out = reinterpret_cast<__m256i*>(dstRow + x * 4);
+            _mm256_storeu_si256(out, _mm256_permute2x128_si256(q0, q1, 0x20));
+            _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(q0, q1, 0x31));
+            _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(q2, q3, 0x20));
+            _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+        }
+        yuy2ToBgraRow(srcRow, dstRow, x, width);
+    }
+#else
+    yuy2ToBgraScalar(src, srcStride, dst, dstStride, width, height);
+#endif
+}
+
+/*
+** NV12 Scalar Reference
+*/
+void PixelKernels::nv12ToBgraScalar(
+    const uint8_t* srcY,
+    size_t strideY,
+    const uint8_t* srcUV,
+    size_t strideUV,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    for(int y = 0; y < height; y++) {
+        nv12ToBgraRow(srcY + y * strideY, srcUV + (y / 2) * strideUV, dst + y * dstStride, 0, width);
+    }
+}
+
+/*
+** NV12 SSE2, 16 pixels per iteration
+*/
+void PixelKernels::nv12ToBgraSSE2(
+    const uint8_t* srcY,
+    size_t strideY,
+    const uint8_t* srcUV,
+    size_t strideUV,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+    const __m128i bias = _mm_set1_epi16(128);
+    for(int y = 0; y < height; y++) {
+        const uint8_t* rowY = srcY + y * strideY;
+        const uint8_t* rowUV = srcUV + (y / 2) * strideUV;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        int x = 0;
+        for(; x + 16 <= width; x += 16) {
+            __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowY + x));
+            __m128i chroma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowUV + x));
+
+            __m128i u = _mm_slli_epi16(_mm_sub_epi16(_mm_and_si128(chroma, lowByte), bias), 6);
+            __m128i v = _mm_slli_epi16(_mm_sub_epi16(_mm_srli_epi16(chroma, 8), bias), 6);
+
+            __m128i r0, g0, b0, r1, g1, b1;
+            yuvConvert8(_mm_unpacklo_epi8(luma, zero), _mm_unpacklo_epi16(u, u), _mm_unpacklo_epi16(v, v), r0, g0, b0);
+            yuvConvert8(_mm_unpackhi_epi8(luma, zero), _mm_unpackhi_epi16(u, u), _mm_unpackhi_epi16(v, v), r1, g1, b1);
+            storeBgra16(dstRow + x * 4, r0, g0, b0, r1, g1, b1);
+        }
+        nv12ToBgraRow(rowY, rowUV, dstRow, x, width);
+    }
+#else
+    nv12ToBgraScalar(srcY, strideY, srcUV, strideUV, dst, dstStride, width, height);
+#endif
+}
+
+/*
+** NV12 AVX2, 32 pixels per iteration
+*/
+KERNEL_TARGET_AVX2 void PixelKernels::nv12ToBgraAVX2(
+    const uint8_t* srcY,
+    size_t strideY,
+    const uint8_t* srcUV,
+    size_t strideUV,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i lowByte = _mm256_set1_epi16(0x00FF);
+    const __m256i bias = _mm256_set1_epi16(128);
+    const __m256i alpha = _mm256_set1_epi8(static_cast<char>(0xFF));
+    for(int y = 0; y < height; y++) {
+        const uint8_t* rowY = srcY + y * strideY;
+        const uint8_t* rowUV = srcUV + (y / 2) * strideUV;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        int x = 0;
+        for(; x + 32 <= width; x += 32) {
+            __m256i luma = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowY + x));
+            __m256i chroma = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowUV + x));
+
+            // Chroma pairs line up with luma per 128-bit lane, so the in-lane unpacks stay matched
+            __m256i u = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_and_si256(chroma, lowByte), bias), 6);
+            __m256i v = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_srli_epi16(chroma, 8), bias), 6);
+
+            __m256i rgb[2][3];
+            for(int half = 0; half < 2; half++) {
+                __m256i yy = half == 0 ? _mm256_unpacklo_epi8(luma, zero) : _mm256_unpackhi_epi8(luma, zero);
+                __m256i uu = half == 0 ? _mm256_unpacklo_epi16(u, u) : _mm256_unpackhi_epi16(u, u);
+                __m256i vv = half == 0 ? _mm256_unpacklo_epi16(v, v) : _mm256_unpackhi_epi16(v, v);
+                rgb[half][0] = _mm256_add_epi16(yy, _mm256_mulhi_epi16(vv, _mm256_set1_epi16(COEF_RV)));
+                rgb[half][1] = _mm256_sub_epi16(
+                    _mm256_sub_epi16(yy, _mm256_mulhi_epi16(uu, _mm256_set1_epi16(COEF_GU))),
+                    _mm256_mulhi_epi16(vv, _mm256_set1_epi16(COEF_GV))
+                );
+                rgb[half][2] = _mm256_add_epi16(yy, _mm256_mulhi_epi16(uu, _mm256_set1_epi16(COEF_BU)));
+            }
+
+            // Lane 0 holds pixels 0-15, lane 1 holds 16-31
+            __m256i r = _mm256_packus_epi16(rgb[0][0], rgb[1][0]);
+            __m256i g = _mm256_packus_epi16(rgb[0][1], rgb[1][1]);
+            __m256i b = _mm256_packus_epi16(rgb[0][2], rgb[1][2]);
+
+            __m256i bgLo = _mm256_unpacklo_epi8(b, g);
+            __m256i bgHi = _mm256_unpackhi_epi8(b, g);
+            __m256i raLo = _mm256_unpacklo_epi8(r, alpha);
+            __m256i raHi = _mm256_unpackhi_epi8(r, alpha);
+
+            __m256i q0 = _mm256_unpacklo_epi16(bgLo, raLo);
+            __m256i q1 = _mm256_unpackhi_epi16(bgLo, raLo);
+            __m256i q2 = _mm256_unpacklo_epi16(bgHi, raHi);
+            __m256i q3 = _mm256_unpackhi_epi16(bgHi, raHi);
+
+            __m256i* out = reinterpret_cast<__m256i*>(dstRow + x * 4);
+            _mm256_storeu_si256(out, _mm256_permute2x128_si256(q0, q1, 0x20));
+            _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(q2, q3, 0x20));
+            _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(q0, q1, 0x31));
+            _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+        }
+        nv12ToBgraRow(rowY, rowUV, dstRow, x, width);
+    }
+#else
+    nv12ToBgraScalar(srcY, strideY, srcUV, strideUV, dst, dstStride, width, height);
+#endif
+}
+
+/*
+** 2x Downscale
+*/
+void PixelKernels::downscale2xScalar(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int dstWidth,
+    int dstHeight
+) {
+    for(int y = 0; y < dstHeight; y++) {
+        downscale2xRow(src + y * 2 * srcStride, srcStride, dst + y * dstStride, 0, dstWidth);
+    }
+}
+
+void PixelKernels::downscale2xSSE2(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int dstWidth,
+    int dstHeight
+) {
+#if defined(KERNELS_X86)
+    const __m128i lowByte = _mm_set1_epi16(0x00FF);
+    const __m128i round = _mm_set1_epi16(2);
+    for(int y = 0; y < dstHeight; y++) {
+        const uint8_t* top = src + y * 2 * srcStride;
+        const uint8_t* bottom = top + srcStride;
+        uint8_t* dstRow = dst + y * dstStride;
+
+        int x = 0;
+        for(; x + 16 <= dstWidth; x += 16) {
+            __m128i half[2];
+            for(int h = 0; h < 2; h++) {
+                __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 2 + h * 16));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 2 + h * 16));
+                __m128i sum = _mm_add_epi16(
+                    _mm_add_epi16(_mm_and_si128(t, lowByte), _mm_srli_epi16(t, 8)),
+                    _mm_add_epi16(_mm_and_si128(b, lowByte), _mm_srli_epi16(b, 8))
+                );
+                half[h] = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dstRow + x), _mm_packus_epi16(half[0], half[1]));
+        }
+        downscale2xRow(top, srcStride, dstRow, x, dstWidth);
+    }
+#else
+    downscale2xScalar(src, srcStride, dst, dstStride, dstWidth, dstHeight);
+#endif
+}
+
+/*
+** Block Difference
+*/
+uint32_t PixelKernels::blockDiffScalar(
+    const uint8_t* a,
+    size_t strideA,
+    const uint8_t* b,
+    size_t strideB,
+    int width,
+    int height
+) {
+    uint32_t total = 0;
+    for(int y = 0; y < height; y++) {
+        total += blockDiffRow(a + y * strideA, b + y * strideB, 0, width);
+    }
+    return total;
+}
+
+uint32_t PixelKernels::blockDiffSSE2(
+    const uint8_t* a,
+    size_t strideA,
+    const uint8_t* b,
+    size_t strideB,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    uint32_t total = 0;
+    for(int y = 0; y < height; y++) {
+        const uint8_t* rowA = a + y * strideA;
+        const uint8_t* rowB = b + y * strideB;
+        __m128i acc = _mm_setzero_si128();
+
+        int x = 0;
+        for(; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowA + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowB + x));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+        }
+        total += static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+        total += blockDiffRow(rowA, rowB, x, width);
+    }
+    return total;
+#else
+    return blockDiffScalar(a, strideA, b, strideB, width, height);
+#endif
+}
+
+KERNEL_TARGET_AVX2 uint32_t PixelKernels::blockDiffAVX2(
+    const uint8_t* a,
+    size_t strideA,
+    const uint8_t* b,
+    size_t strideB,
+    int width,
+    int height
+) {
+#if defined(KERNELS_X86)
+    uint32_t total = 0;
+    for(int y = 0; y < height; y++) {
+        const uint8_t* rowA = a + y * strideA;
+        const uint8_t* rowB = b + y * strideB;
+        __m256i acc = _mm256_setzero_si256();
+
+        int x = 0;
+        for(; x + 32 <= width; x += 32) {
+            __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowA + x));
+            __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rowB + x));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+        }
+        __m128i folded = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        total += static_cast<uint32_t>(_mm_cvtsi128_si32(folded) + _mm_cvtsi128_si32(_mm_srli_si128(folded, 8)));
+        total += blockDiffRow(rowA, rowB, x, width);
+    }
+    return total;
+#else
+    return blockDiffScalar(a, strideA, b, strideB, width, height);
+#endif
+}
+
+/*
+** Dispatch
+*/
+void PixelKernels::yuy2ToBgra(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    KernelRegistry::get().yuy2ToBgra.fn(src, srcStride, dst, dstStride, width, height);
+}
+
+void PixelKernels::nv12ToBgra(
+    const uint8_t* srcY,
+    size_t strideY,
+    const uint8_t* srcUV,
+    size_t strideUV,
+    uint8_t* dst,
+    size_t dstStride,
+    int width,
+    int height
+) {
+    KernelRegistry::get().nv12ToBgra.fn(srcY, strideY, srcUV, strideUV, dst, dstStride, width, height);
+}
+
+void PixelKernels::downscale2x(
+    const uint8_t* src,
+    size_t srcStride,
+    uint8_t* dst,
+    size_t dstStride,
+    int dstWidth,
+    int dstHeight
+) {
+    KernelRegistry::get().downscale2x.fn(src, srcStride, dst, dstStride, dstWidth, dstHeight);
+}
+
+uint32_t PixelKernels::blockDiff(
+    const uint8_t* a,
+    size_t strideA,
+    const uint8_t* b,
+    size_t strideB,
+    int width,
+    int height
+) {
+    return KernelRegistry::get().blockDiff.fn(a, strideA, b, strideB, width, height);
+}
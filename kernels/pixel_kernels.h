@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/*
+** Colour conversion and plane kernels. Every colour variant uses the
+** same fixed-point BT.601 full-range coefficients (Q10), so the SIMD
+** paths reproduce the scalar reference exactly. Strides are in bytes.
+** The unsuffixed entry points call whatever KernelRegistry bound.
+*/
+class PixelKernels {
+    public:
+        static void yuy2ToBgra(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+
+        static void yuy2ToBgraScalar(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        static void yuy2ToBgraSSE2(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        static void yuy2ToBgraAVX2(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+
+        static void nv12ToBgra(
+            const uint8_t* srcY,
+            size_t strideY,
+            const uint8_t* srcUV,
+            size_t strideUV,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+
+        static void nv12ToBgraScalar(
+            const uint8_t* srcY,
+            size_t strideY,
+            const uint8_t* srcUV,
+            size_t strideUV,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        static void nv12ToBgraSSE2(
+            const uint8_t* srcY,
+            size_t strideY,
+            const uint8_t* srcUV,
+            size_t strideUV,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+        static void nv12ToBgraAVX2(
+            const uint8_t* srcY,
+            size_t strideY,
+            const uint8_t* srcUV,
+            size_t strideUV,
+            uint8_t* dst,
+            size_t dstStride,
+            int width,
+            int height
+        );
+
+        /*
+        ** 2x box downscale of an 8-bit plane, rounded to nearest
+        */
+        static void downscale2x(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int dstWidth,
+            int dstHeight
+        );
+        static void downscale2xScalar(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int dstWidth,
+            int dstHeight
+        );
+        static void downscale2xSSE2(
+            const uint8_t* src,
+            size_t srcStride,
+            uint8_t* dst,
+            size_t dstStride,
+            int dstWidth,
+            int dstHeight
+        );
+
+        /*
+        ** Sum of absolute differences between two 8-bit blocks
+        */
+        static uint32_t blockDiff(
+            const uint8_t* a,
+            size_t strideA,
+            const uint8_t* b,
+            size_t strideB,
+            int width,
+            int height
+        );
+        static uint32_t blockDiffScalar(
+            const uint8_t* a,
+            size_t strideA,
+            const uint8_t* b,
+            size_t strideB,
+            int width,
+            int height
+        );
+        static uint32_t blockDiffSSE2(
+            const uint8_t* a,
+            size_t strideA,
+            const uint8_t* b,
+            size_t strideB,
+            int width,
+            int height
+        );
+        static uint32_t blockDiffAVX2(
+            const uint8_t* a,
+            size_t strideA,
+            const uint8_t* b,
+            size_t strideB,
+            int width,
+            int height
+        );
+};
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <algorithm>
 #include <regex>
+#include <sstream>
 #include "parser.h"
 
 bool Loader::loadFile(
@@ -142,4 +143,139 @@ bool Loader::loadFile(
     }
     
     return !cascade.stages.empty();
+}
+
+/*
+** Save File
+*/
+bool Loader::saveFile(
+    const std::string& name,
+    const HaarCascade& cascade
+) {
+    std::ofstream file(name);
+    if(!file.is_open()) {
+        std::wcout << L"Failed to write cascade: " << name.c_str() << std::endl;
+        return false;
+    }
+
+    size_t maxWeakCount = 0;
+    for(const auto& stage : cascade.stages) {
+        maxWeakCount = (std::max)(maxWeakCount, stage.weakClassifiers.size());
+    }
+
+    file << std::scientific;
+    file.precision(16);
+    file << "<?xml version=\"1.0\"?>\n";
+    file << "<opencv_storage>\n";
+    file << "<cascade type_id=\"opencv-cascade-classifier\"><stageType>BOOST</stageType>\n";
+    file << "  <featureType>HAAR</featureType>\n";
+    file << "  <height>" << cascade.baseHeight << "</height>\n";
+    file << "  <width>" << cascade.baseWidth << "</width>\n";
+    file << "  <stageParams>\n";
+    file << "    <maxWeakCount>" << maxWeakCount << "</maxWeakCount></stageParams>\n";
+    file << "  <featureParams>\n";
+    file << "    <maxCatCount>0</maxCatCount></featureParams>\n";
+    file << "  <stageNum>" << cascade.stages.size() << "</stageNum>\n";
+    file << "  <stages>\n";
+
+    // One tag per line so the line-based parser above can read it back;
+    // Parser::createFeatureFromIndex only keys on index % 5, so the feature type round-trips as the index
+    for(size_t s = 0; s < cascade.stages.size(); s++) {
+        const StrongClassifier& stage = cascade.stages[s];
+        file << "    <!-- stage " << s << " -->\n";
+        file << "    <_>\n";
+        file << "      <maxWeakCount>" << stage.weakClassifiers.size() << "</maxWeakCount>\n";
+        file << "      <stageThreshold>" << stage.threshold << "</stageThreshold>\n";
+        file << "      <weakClassifiers>\n";
+        for(const auto& wc : stage.weakClassifiers) {
+            file << "        <_>\n";
+            file << "          <internalNodes>\n";
+            file << "            0 -1 " << static_cast<int>(wc.feature.type) << " " << wc.feature.threshold << "</internalNodes>\n";
+            file << "          <leafValues>\n";
+            file << "            " << wc.weight * wc.feature.leftVal << " " << wc.weight * wc.feature.rightVal << "</leafValues>\n";
+            file << "        </_>\n";
+        }
+        file << "      </weakClassifiers>\n";
+        file << "    </_>\n";
+    }
+    file << "  </stages>\n";
+    file << "</cascade>\n";
+    file << "</opencv_storage>\n";
+
+    std::wcout << L"Saved " << cascade.stages.size() << L" stages to " << name.c_str() << std::endl;
+    return true;
+}
+
+/*
+** Rejection Traces
+*/
+bool Loader::loadRejectionTraces(
+    const std::string& name,
+    HaarCascade& cascade
+) {
+    std::ifstream file(name);
+    if(!file.is_open()) {
+        std::wcout << L"No rejection traces at " << name.c_str() << L", using full stages" << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int loadedStages = 0;
+    while(std::getline(file, line)) {
+        std::string trimmed = Parser::trim(line);
+        if(trimmed.empty() || trimmed[0] == '#') continue;
+
+        std::istringstream fields(trimmed);
+        std::string keyword;
+        if(!(fields >> keyword) || keyword != "stage") continue;
+
+        // The file sits next to the cascade and is picked up on its own, so a bad line is skipped, not fatal
+        size_t stageIndex = 0;
+        size_t count = 0;
+        if(!(fields >> stageIndex >> count)) {
+            std::wcout << L"Malformed trace line skipped: " << line.c_str() << std::endl;
+            continue;
+        }
+        std::vector<float> trace;
+        float value = 0.0f;
+        while(fields >> value) trace.push_back(value);
+        if(!fields.eof() || trace.size() != count) {
+            std::wcout << L"Malformed trace for stage " << stageIndex << std::endl;
+            continue;
+        }
+        if(stageIndex >= cascade.stages.size() || cascade.stages[stageIndex].weakClassifiers.size() != count) {
+            std::wcout << L"Trace for stage " << stageIndex << L" does not match cascade, skipped" << std::endl;
+            continue;
+        }
+        cascade.stages[stageIndex].rejectionTrace = trace;
+        loadedStages++;
+    }
+
+    std::wcout << L"Loaded rejection traces for " << loadedStages << L" stages" << std::endl;
+    return loadedStages > 0;
+}
+
+bool Loader::saveRejectionTraces(
+    const std::string& name,
+    const HaarCascade& cascade
+) {
+    std::ofstream file(name);
+    if(!file.is_open()) {
+        std::wcout << L"Failed to write traces: " << name.c_str() << std::endl;
+        return false;
+    }
+
+    file << "# stage <index> <count> <partial sum floor per weak classifier>\n";
+    file.precision(9);
+    for(size_t s = 0; s < cascade.stages.size(); s++) {
+        const StrongClassifier& stage = cascade.stages[s];
+        if(!stage.hasRejectionTrace()) continue;
+
+        file << "stage " << s << " " << stage.rejectionTrace.size();
+        for(float v : stage.rejectionTrace) {
+            file << " " << v;
+        }
+        file << "\n";
+    }
+    return true;
 }
\ No newline at end of file
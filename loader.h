@@ -13,4 +13,16 @@ class Loader {
             const std::string& name,
             HaarCascade& cascade
         );
+        static bool saveFile(
+            const std::string& name,
+            const HaarCascade& cascade
+        );
+        static bool loadRejectionTraces(
+            const std::string& name,
+            HaarCascade& cascade
+        );
+        static bool saveRejectionTraces(
+            const std::string& name,
+            const HaarCascade& cascade
+        );
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "window_manager.h"
+#include "kernels/kernel_registry.h"
+#include "runtime/thread_pool.h"
 #include <iostream>
 
 class Main {
@@ -6,6 +8,9 @@ class Main {
 
     public: Main() {
         std::wcout << L"Main app init" << std::endl;
+        KernelRegistry::get();
+        // Sized from CAMVALLEY_THREADS, or one thread per core
+        ThreadPool::shared();
     }
 
     public: int run() {
@@ -1,40 +1,73 @@
 #include "classifier_renderer.h"
 #include "../loader.h"
 #include <iostream>
-#include <chrono>
+
+namespace {
+    // Faces in a row inside the learned ranges before the map is trusted
+    const int SCALE_MAP_STABLE_FACES = 50;
+}
 
 bool ClassifierRenderer::load(const std::string& fileName) {
     Loader loader;
     cascadeLoaded = loader.loadFile(fileName, faceCascade);
+    if(cascadeLoaded) loader.loadRejectionTraces(fileName + ".trace", faceCascade);
     return cascadeLoaded && faceCascade.isLoaded();
 }
 
 /*
-** Create Integral Image
+** Scale Map
 */
-std::vector<std::vector<float>> ClassifierRenderer::createIntegralImage(const std::vector<std::vector<unsigned char>>& image) {
-    if (image.empty() || image[0].empty()) {
-        return std::vector<std::vector<float>>();
-    }
-    
-    int height = image.size();
-    int width = image[0].size();
-    std::vector<std::vector<float>> integral(height, std::vector<float>(width, 0));
-
-    integral[0][0] = image[0][0];
-    for(int x = 1; x < width; x++) {
-        integral[0][x] = integral[0][x-1] + image[0][x];
+bool ClassifierRenderer::loadScaleMap(const std::string& fileName) {
+    return scaleMap.load(fileName);
+}
+
+/*
+** While learning, every size is scanned and the faces found fill in
+** the bands. Once new faces stop widening the ranges the map is saved
+** and scans start using it.
+*/
+void ClassifierRenderer::enableScaleMapLearning(int bands, const std::string& saveTo) {
+    if(scaleMap.isEmpty()) scaleMap.reset(bands);
+    learnedScaleMapFile = saveTo;
+    learnScaleMap = true;
+}
+
+void ClassifierRenderer::finishScaleMapLearning() {
+    learnScaleMap = false;
+    std::wcout << L"Scale map learned over " << scaleMap.bands.size() << L" bands" << std::endl;
+    if(learnedScaleMapFile.empty()) return;
+    if(scaleMap.save(learnedScaleMapFile)) {
+        std::wcout << L"Scale map saved to " << learnedScaleMapFile.c_str() << std::endl;
+    } else {
+        std::wcout << L"Failed to save scale map: " << learnedScaleMapFile.c_str() << std::endl;
     }
+}
 
-    for(int y = 1; y < height; y++) {
-        float rowSum = 0;
-        for(int x = 0; x < width; x++) {
-            rowSum += image[y][x];
-            integral[y][x] = integral[y-1][x] + rowSum;
-        }
+bool ClassifierRenderer::loadExclusionMask(const std::string& fileName) {
+    return exclusionMask.load(fileName);
+}
+
+/*
+** Decimation
+*/
+bool ClassifierRenderer::setDecimation(int factor) {
+    if(factor != 1 && factor != 2 && factor != 4) {
+        std::wcout << L"Unsupported decimation factor: " << factor << std::endl;
+        return false;
     }
+    scanConfig.decimation = factor;
+    return true;
+}
+
+/*
+** Thread Pool
+*/
+void ClassifierRenderer::setThreadPool(ThreadPool* pool) {
+    threadPool = pool;
+}
 
-    return integral;
+void ClassifierRenderer::setFacesCallback(std::function<void(const std::vector<Rect>&)> callback) {
+    facesCallback = callback;
 }
 
 void ClassifierRenderer::forceEnable() {
@@ -44,24 +77,54 @@ void ClassifierRenderer::forceEnable() {
 
 /*
 ** Process Frame for Faces
+**
+** Frames are handed to the detection stages and this returns right
+** away; faces arrive later through onFaces(), in frame order, while the
+** next frames are already being converted. The rate controller picks
+** which frames go, from the measured cost and how much is changing.
+** A completion follows that one frame to its result, or to being
+** dropped for a newer one.
 */
-void ClassifierRenderer::processFrameForFaces(const std::vector<std::vector<unsigned char>>& frame) {
-    static auto lastProcessTime = std::chrono::steady_clock::now();
-    auto currentTime = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastProcessTime);
-    if(elapsed.count() < 66) return;
-    lastProcessTime = currentTime;
-
-    if(!faceDetectionEnabled || !isCascadeLoaded()) return;
-    if(frame.empty() || frame[0].empty()) return;
-
-    auto integral = createIntegralImage(frame);
-    if(integral.empty()) return;
-    auto newFaces = faceCascade.detectFaces(integral);
-    {
-        std::lock_guard<std::mutex> lock(facesMutex);
-        currentFaces = newFaces;
+bool ClassifierRenderer::processFrameForFaces(
+    const FrameHandle& frame,
+    DetectionStages::Completion completion
+) {
+    if(!faceDetectionEnabled || !isCascadeLoaded()) return false;
+    if(!frame || frame->empty()) return false;
+    if(!rateController.shouldDetect(frame.view())) return false;
+
+    if(!detectionStages) {
+        detectionStages.reset(new DetectionStages(faceCascade, threadPool ? *threadPool : ThreadPool::shared()));
+        detectionStages->setResultCallback([this](const PipelineResult& result) {
+            onFaces(result);
+        });
+        detectionStages->qualityController = &qualityController;
+    }
+    detectionStages->scanConfig = scanConfig;
+    detectionStages->useSquaredIntegral = useSquaredIntegral;
+    detectionStages->exclusionMask = exclusionMask.isEmpty() ? nullptr : &exclusionMask;
+    // While learning, the map changes on the publish stage; scan every size until it is done
+    detectionStages->scaleMap = learnScaleMap || scaleMap.isEmpty() ? nullptr : &scaleMap;
+    return detectionStages->submit(frame, false, completion);
+}
+
+void ClassifierRenderer::onFaces(const PipelineResult& result) {
+    rateController.reportDetection(result.workMs, result.faces.size());
+    if(learnScaleMap) {
+        scaleMap.learn(result.faces, result.height);
+        if(scaleMap.hasConverged(SCALE_MAP_STABLE_FACES)) finishScaleMapLearning();
     }
+    results.store(FaceSnapshot(result));
+    if(facesCallback) facesCallback(result.faces);
+}
+
+void ClassifierRenderer::stopDetection() {
+    if(!detectionStages) return;
+    detectionStages->drain();
+    std::wcout << L"Detection stages:" << std::endl;
+    detectionStages->logStats();
+    rateController.logMetrics();
+    qualityController.logMetrics();
 }
 
 /*
@@ -94,7 +157,8 @@ void ClassifierRenderer::draw(HDC hdc, const std::vector<Rect>& faces) {
     SelectObject(hdc, oldBrush);
 }
 
-std::vector<Rect> ClassifierRenderer::getCurrentFaces() {
-    std::lock_guard<std::mutex> lock(facesMutex);
-    return currentFaces;
+std::vector<Rect> ClassifierRenderer::getCurrentFaces() const {
+    FaceSnapshot snapshot;
+    results.load(snapshot);
+    return snapshot.toVector();
 }
\ No newline at end of file
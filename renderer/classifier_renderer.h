@@ -1,20 +1,69 @@
 #include "../classifier/classifier.h"
 #include "../classifier/haar_cascade.h"
+#include "../classifier/scale_map.h"
+#include "../classifier/exclusion_mask.h"
+#include "../classifier/window_plan.h"
+#include "../source/frame_pool.h"
+#include "../runtime/detection_rate.h"
+#include "../runtime/detection_stages.h"
+#include "../runtime/result_channel.h"
+#include "../runtime/scan_quality.h"
+#include "../runtime/thread_pool.h"
 #include <windows.h>
+#include <atomic>
+#include <functional>
 #include <thread>
 #include <iostream>
+#include <memory>
 #include <mutex>
 
 class ClassifierRenderer {
     public:
         HaarCascade faceCascade;
-        std::vector<Rect> currentFaces;
-        std::mutex facesMutex;
+        ScaleMap scaleMap;
+        // Set while the map is learned; cleared by the publish stage once it has settled
+        std::atomic<bool> learnScaleMap;
+        // Where a learned map is saved once it has settled; empty keeps it in memory only
+        std::string learnedScaleMapFile;
+        ExclusionMask exclusionMask;
+        ScanConfig scanConfig;
+        ThreadPool* threadPool;
+        DetectionRateController rateController;
+        // Coarsens scanConfig when detection runs over its p95 target
+        ScanQualityController qualityController;
+        std::function<void(const std::vector<Rect>&)> facesCallback;
+        bool useSquaredIntegral;
+        // Latest faces; the only copy, written by the publish stage and read without locks
+        FaceChannel results;
         bool faceDetectionEnabled;
         bool cascadeLoaded;
+        // Created on the first frame, once the cascade is in; last, so it drains before the rest goes
+        std::unique_ptr<DetectionStages> detectionStages;
+
+        ClassifierRenderer() :
+            learnScaleMap(false),
+            threadPool(nullptr),
+            useSquaredIntegral(false),
+            faceDetectionEnabled(false),
+            cascadeLoaded(false) {}
 
         bool load(const std::string& fileName);
-        void processFrameForFaces(const std::vector<std::vector<unsigned char>>& frame);
+        bool loadScaleMap(const std::string& fileName);
+        void enableScaleMapLearning(
+            int bands,
+            const std::string& saveTo = std::string()
+        );
+        bool setDecimation(int factor);
+        void setThreadPool(ThreadPool* pool);
+        bool loadExclusionMask(const std::string& fileName);
+        // Called from the publish stage with every new set of faces
+        void setFacesCallback(std::function<void(const std::vector<Rect>&)> callback);
+        // False when the frame was passed over; a completion then never runs
+        bool processFrameForFaces(
+            const FrameHandle& frame,
+            DetectionStages::Completion completion = DetectionStages::Completion()
+        );
+        void stopDetection();
         void draw(HDC hdc, const std::vector<Rect>& faces);
 
         void forceEnable();
@@ -27,8 +76,12 @@ class ClassifierRenderer {
         HaarCascade& getFaceCascade() {
             return faceCascade;
         }
-        std::vector<Rect> getCurrentFaces();
-        std::vector<std::vector<float>> createIntegralImage(
-            const std::vector<std::vector<unsigned char>>& image
-        );
+        std::vector<Rect> getCurrentFaces() const;
+        DetectionRateController::Metrics getRateMetrics() const {
+            return rateController.getMetrics();
+        }
+
+    private:
+        void onFaces(const PipelineResult& result);
+        void finishScaleMapLearning();
 };
\ No newline at end of file
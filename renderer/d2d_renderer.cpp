@@ -2,6 +2,8 @@
 #include <iostream>
 #include <d2d1.h>
 #include <d2d1helper.h>
+#include "../kernels/pixel_kernels.h"
+#include "../source/frame_format.h"
 #pragma comment(lib, "d2d1.lib")
 #pragma comment(lib, "windowscodecs.lib")
 
@@ -52,9 +54,7 @@ bool D2DRenderer::init(HWND hwnd) {
 
 bool D2DRenderer::renderFrame(
     IMFSample* pSample,
-    UINT32 frameWidth,
-    UINT32 frameHeight,
-    GUID pixelFormat
+    const FrameFormat& format
 ) {
     if(!pSample || !pRenderTarget) {
         std::wcout << L"Invalid sample or render target" << std::endl;
@@ -80,8 +80,9 @@ bool D2DRenderer::renderFrame(
     }
 
     try {
-        UINT32 actualWidth = frameWidth;
-        UINT32 actualHeight = frameHeight;
+        UINT32 actualWidth = static_cast<UINT32>(format.width);
+        UINT32 actualHeight = static_cast<UINT32>(format.height);
+        PixelFormat pixelFormat = format.pixelFormat;
         if(actualWidth == 0 || actualHeight == 0) {
             std::wcout << L"Invalid frame dimensions: " 
                 << actualWidth << L"x" << actualHeight << std::endl;
@@ -90,20 +91,21 @@ bool D2DRenderer::renderFrame(
             return false;
         }
 
-        UINT32 expectedSize = 0;
-        UINT32 bytesPerPixel = 4;
-        UINT32 stride = actualWidth * bytesPerPixel;
-        
-        if(pixelFormat == MFVideoFormat_YUY2) {
-            bytesPerPixel = 2;
-            stride = actualWidth * bytesPerPixel;
-            expectedSize = stride * actualHeight;
-        } else if(pixelFormat == MFVideoFormat_RGB32) {
-            bytesPerPixel = 4;
-            stride = actualWidth * bytesPerPixel;
-            expectedSize = stride * actualHeight;
-        } else {
-            std::wcout << L"Unsupported pixel format: " << &pixelFormat << std::endl;
+        UINT32 stride = static_cast<UINT32>(format.stride);
+        UINT32 expectedSize = static_cast<UINT32>(format.bufferSize());
+        if(
+            pixelFormat != PixelFormat::YUY2 &&
+            pixelFormat != PixelFormat::RGB32 &&
+            pixelFormat != PixelFormat::NV12
+        ) {
+            std::wcout << L"Unsupported pixel format: " << pixelFormatName(pixelFormat) << std::endl;
+            pBuffer->Unlock();
+            pBuffer->Release();
+            return false;
+        }
+        if(pixelFormat == PixelFormat::NV12 && currentLength < expectedSize) {
+            std::wcout << L"Short NV12 buffer. Expected: " << expectedSize
+                      << L" got: " << currentLength << std::endl;
             pBuffer->Unlock();
             pBuffer->Release();
             return false;
@@ -116,15 +118,41 @@ bool D2DRenderer::renderFrame(
         }
 
         std::wcout << L"Rendering frame: " << actualWidth << L"x" << actualHeight 
-                  << L" Format: " << (pixelFormat == MFVideoFormat_YUY2 ? L"YUY2" : L"RGB32")
+                  << L" Format: " << pixelFormatName(pixelFormat)
                   << L" data size: " << currentLength << std::endl;
 
-        std::vector<BYTE> rgbData;
         BYTE* renderData = pData;
-        if(pixelFormat == MFVideoFormat_YUY2) {
-            rgbData.resize(actualWidth * actualHeight * 4);
-            convertYUY2ToRGB32(pData, currentLength, rgbData.data(), actualWidth, actualHeight);
-            renderData = rgbData.data();
+        if(pixelFormat == PixelFormat::YUY2) {
+            UINT32 srcStride = static_cast<UINT32>(format.stride);
+            UINT32 rows = (std::min)(actualHeight, static_cast<UINT32>(currentLength / srcStride));
+            if(rgbBuffer.size() != actualWidth * actualHeight * 4) {
+                rgbBuffer.assign(actualWidth * actualHeight * 4, 0);
+            }
+            PixelKernels::yuy2ToBgra(
+                pData,
+                srcStride,
+                rgbBuffer.data(),
+                actualWidth * 4,
+                actualWidth,
+                rows
+            );
+            renderData = rgbBuffer.data();
+            stride = actualWidth * 4;
+        } else if(pixelFormat == PixelFormat::NV12) {
+            if(rgbBuffer.size() != actualWidth * actualHeight * 4) {
+                rgbBuffer.assign(actualWidth * actualHeight * 4, 0);
+            }
+            PixelKernels::nv12ToBgra(
+                pData,
+                format.stride,
+                pData + format.stride * actualHeight,
+                format.stride,
+                rgbBuffer.data(),
+                actualWidth * 4,
+                actualWidth,
+                actualHeight
+            );
+            renderData = rgbBuffer.data();
             stride = actualWidth * 4;
         }
 
@@ -232,55 +260,6 @@ bool D2DRenderer::renderFrame(
     }
 }
 
-void D2DRenderer::convertYUY2ToRGB32(
-    const BYTE* yuy2Data, 
-    DWORD yuy2Length,
-    BYTE* rgbData, 
-    UINT32 width, 
-    UINT32 height
-) {
-    for (UINT32 y = 0; y < height; y++) {
-        for (UINT32 x = 0; x < width; x += 2) {
-            DWORD yuy2Offset = (y * width + x) * 2;
-            if(yuy2Offset + 3 >= yuy2Length) break;
-            
-            BYTE y0 = yuy2Data[yuy2Offset];
-            BYTE u  = yuy2Data[yuy2Offset + 1];
-            BYTE y1 = yuy2Data[yuy2Offset + 2];
-            BYTE v  = yuy2Data[yuy2Offset + 3];
-            
-            int r0 = y0 + 1.402f * (v - 128);
-            int g0 = y0 - 0.344f * (u - 128) - 0.714f * (v - 128);
-            int b0 = y0 + 1.772f * (u - 128);
-            
-            int r1 = y1 + 1.402f * (v - 128);
-            int g1 = y1 - 0.344f * (u - 128) - 0.714f * (v - 128);
-            int b1 = y1 + 1.772f * (u - 128);
-            
-            r0 = (std::max)(0, (std::min)(255, r0));
-            g0 = (std::max)(0, (std::min)(255, g0));
-            b0 = (std::max)(0, (std::min)(255, b0));
-            r1 = (std::max)(0, (std::min)(255, r1));
-            g1 = (std::max)(0, (std::min)(255, g1));
-            b1 = (std::max)(0, (std::min)(255, b1));
-            
-            DWORD rgbOffset0 = (y * width + x) * 4;
-            rgbData[rgbOffset0] = b0;
-            rgbData[rgbOffset0 + 1] = g0;
-            rgbData[rgbOffset0 + 2] = r0;
-            rgbData[rgbOffset0 + 3] = 255;
-
-            if(x + 1 < width) {
-                DWORD rgbOffset1 = (y * width + x + 1) * 4;
-                rgbData[rgbOffset1] = b1;
-                rgbData[rgbOffset1 + 1] = g1;
-                rgbData[rgbOffset1 + 2] = r1;
-                rgbData[rgbOffset1 + 3] = 255;
-            }
-        }
-    }
-}
-
 void D2DRenderer::resize(UINT32 newWidth, UINT32 newHeight) {
     if(pRenderTarget && newWidth > 0 && newHeight > 0) {
         width = newWidth;
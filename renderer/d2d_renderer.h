@@ -5,8 +5,10 @@
 #include <Windows.h>
 #include <mfapi.h>
 #include <mfidl.h>
+#include <vector>
 #include "../controller/capture_controller.h"
 #include "../window_manager.h"
+#include "../source/frame_format.h"
 
 class D2DRenderer {
     private:
@@ -16,13 +18,7 @@ class D2DRenderer {
         HWND hwndVideo;
         UINT32 width;
         UINT32 height;
-        void convertYUY2ToRGB32(
-            const BYTE* yuy2Data, 
-            DWORD yuy2Length,
-            BYTE* rgbData, 
-            UINT32 width, 
-            UINT32 height
-        );
+        std::vector<BYTE> rgbBuffer;
 
     public:
         D2DRenderer();
@@ -31,9 +27,7 @@ class D2DRenderer {
         bool init(HWND hwnd);
         bool renderFrame(
             IMFSample* pSample,
-            UINT32 frameWidth,
-            UINT32 frameHeight,
-            GUID pixelFormat
+            const FrameFormat& format
         );
         void resize(UINT32 newWidth, UINT32 newHeight);
         void cleanup();
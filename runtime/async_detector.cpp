@@ -0,0 +1,98 @@
+#include "async_detector.h"
+#include <iostream>
+#include <memory>
+
+AsyncDetector::AsyncDetector(
+    const HaarCascade& cascade,
+    ThreadPool* pool,
+    size_t maxInFlight
+) :
+    useSquaredIntegral(false),
+    exclusionMask(nullptr),
+    scaleMap(nullptr),
+    maxInFlight(maxInFlight ? maxInFlight : 1),
+    // As deep as the flight limit, so a frame let in never waits on the first stage
+    stages(cascade, pool ? *pool : ThreadPool::shared(), this->maxInFlight),
+    inFlight(0),
+    completed(0) {}
+
+AsyncDetector::~AsyncDetector() {
+    drain();
+}
+
+/*
+** Submit
+*/
+std::future<PipelineResult> AsyncDetector::submit(const FrameHandle& frame) {
+    auto promise = std::make_shared<std::promise<PipelineResult>>();
+    std::future<PipelineResult> result = promise->get_future();
+    bool taken = submit(frame, [promise](const PipelineResult& published) {
+        promise->set_value(published);
+    });
+    if(!taken) promise->set_value(PipelineResult());
+    return result;
+}
+
+bool AsyncDetector::submit(const FrameHandle& frame, Callback callback) {
+    if(!frame || frame->empty()) return false;
+
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+    {
+        std::unique_lock<std::mutex> lock(flightMutex);
+        flightCondition.wait(lock, [this]() {
+            return inFlight < maxInFlight;
+        });
+        inFlight++;
+    }
+
+    stages.scanConfig = scanConfig;
+    stages.useSquaredIntegral = useSquaredIntegral;
+    stages.exclusionMask = exclusionMask;
+    stages.scaleMap = scaleMap;
+    // drain() covers the callback itself through the stages
+    bool taken = stages.submit(frame, true, [this, callback](const PipelineResult& result) {
+        finish();
+        if(callback) callback(result);
+    });
+    if(!taken) finish();
+    return taken;
+}
+
+void AsyncDetector::finish() {
+    {
+        std::lock_guard<std::mutex> lock(flightMutex);
+        inFlight--;
+        completed++;
+    }
+    flightCondition.notify_all();
+}
+
+void AsyncDetector::drain() {
+    {
+        std::unique_lock<std::mutex> lock(flightMutex);
+        flightCondition.wait(lock, [this]() {
+            return inFlight == 0;
+        });
+    }
+    // The last callbacks may still be running on the publish stage
+    stages.drain();
+}
+
+/*
+** Stats
+*/
+size_t AsyncDetector::getInFlight() const {
+    std::lock_guard<std::mutex> lock(flightMutex);
+    return inFlight;
+}
+
+uint64_t AsyncDetector::getCompleted() const {
+    std::lock_guard<std::mutex> lock(flightMutex);
+    return completed;
+}
+
+void AsyncDetector::logStats() const {
+    std::wcout << L"Async detection: " << getCompleted() << L" frames, "
+               << maxInFlight << L" in flight at most" << std::endl;
+    stages.logStats();
+}
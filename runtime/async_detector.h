@@ -0,0 +1,78 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include "../classifier/haar_cascade.h"
+#include "../classifier/exclusion_mask.h"
+#include "../classifier/scale_map.h"
+#include "../classifier/window_plan.h"
+#include "../source/frame_pool.h"
+#include "detection_stages.h"
+#include "thread_pool.h"
+
+/*
+** Detection as a call that returns right away. submit() hands back a
+** future, or takes a callback, for the faces of that very frame; the
+** result carries the frame's sequence number and capture timestamp,
+** so it can be matched up whatever the caller does meanwhile.
+**
+** Up to maxInFlight frames are between submit() and their result at
+** once, spread over the stages and the pool; past that submit() waits
+** for one to come out. A batch loop can therefore submit every frame
+** as fast as it reads them and collect the futures in order. Nothing
+** is dropped: a result with detected unset means the frame could not
+** be converted. Results complete in submission order.
+**
+** submit() may be called from any thread, and frames from several
+** threads are taken one at a time. Not from a callback, though:
+** callbacks run on the publish stage, which every frame in flight
+** still has to get through.
+*/
+class AsyncDetector {
+    public:
+        typedef DetectionStages::Completion Callback;
+
+        // Read at submit()
+        ScanConfig scanConfig;
+        bool useSquaredIntegral;
+        const ExclusionMask* exclusionMask;
+        const ScaleMap* scaleMap;
+
+        // Without a pool the shared one is used
+        AsyncDetector(
+            const HaarCascade& cascade,
+            ThreadPool* pool = nullptr,
+            size_t maxInFlight = 4
+        );
+        ~AsyncDetector();
+
+        AsyncDetector(const AsyncDetector&) = delete;
+        AsyncDetector& operator=(const AsyncDetector&) = delete;
+
+        std::future<PipelineResult> submit(const FrameHandle& frame);
+        // False for an empty frame; the callback runs on the publish stage
+        bool submit(const FrameHandle& frame, Callback callback);
+        // Blocks until every submitted frame has its result
+        void drain();
+
+        size_t getMaxInFlight() const {
+            return maxInFlight;
+        }
+        size_t getInFlight() const;
+        uint64_t getCompleted() const;
+        void logStats() const;
+
+    private:
+        size_t maxInFlight;
+        DetectionStages stages;
+
+        std::mutex submitMutex;
+        mutable std::mutex flightMutex;
+        std::condition_variable flightCondition;
+        size_t inFlight;
+        uint64_t completed;
+
+        void finish();
+};
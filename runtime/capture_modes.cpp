@@ -0,0 +1,224 @@
+#include "capture_modes.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    const double SMOOTHING = 0.2;
+    // A measured scan never calibrates below this share of the estimate
+    const double MIN_CALIBRATION = 0.05;
+
+    int tier(const RankedCaptureMode& ranked) {
+        if(ranked.adequate && ranked.withinBudget) return 0;
+        return ranked.adequate ? 1 : 2;
+    }
+
+    double convertMs(const CaptureMode& mode, const CaptureBudget& budget) {
+        size_t stride = static_cast<size_t>(mode.width) * pixelFormatBytes(mode.pixelFormat);
+        return frameBufferSize(mode.pixelFormat, stride, mode.height) / 1e6 * budget.convertMsPerMegabyte;
+    }
+}
+
+/*
+** Ranking
+*/
+double estimateCaptureCost(const CaptureMode& mode, const CaptureBudget& budget) {
+    int decimation = (std::max)(budget.decimation, 1);
+    double scanMs = mode.megapixels() / (decimation * decimation) * budget.scanMsPerMegapixel;
+    return scanMs + convertMs(mode, budget);
+}
+
+std::vector<RankedCaptureMode> rankCaptureModes(
+    const std::vector<CaptureMode>& modes,
+    const CaptureBudget& budget
+) {
+    double frameBudgetMs = budget.frameBudgetMs();
+    int smallestFace = budget.windowSize * (std::max)(budget.decimation, 1);
+
+    std::vector<RankedCaptureMode> ranked;
+    ranked.reserve(modes.size());
+    for(const auto& mode : modes) {
+        if(pixelFormatBytes(mode.pixelFormat) == 0 || mode.width <= 0 || mode.height <= 0) continue;
+
+        RankedCaptureMode entry;
+        entry.mode = mode;
+        entry.costMs = estimateCaptureCost(mode, budget);
+        entry.withinBudget = entry.costMs <= frameBudgetMs;
+        // An unreported frame rate is taken on trust
+        bool smooth = mode.fps <= 0.0 || mode.fps >= budget.minFps;
+        entry.adequate = smooth && budget.minFaceFraction * mode.height >= smallestFace;
+        ranked.push_back(entry);
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [](const RankedCaptureMode& a, const RankedCaptureMode& b) {
+        int tierA = tier(a);
+        int tierB = tier(b);
+        if(tierA != tierB) return tierA < tierB;
+
+        long long pixelsA = static_cast<long long>(a.mode.width) * a.mode.height;
+        long long pixelsB = static_cast<long long>(b.mode.width) * b.mode.height;
+        if(tierA == 1) {
+            if(a.costMs != b.costMs) return a.costMs < b.costMs;
+        } else if(pixelsA != pixelsB) {
+            return pixelsA > pixelsB;
+        }
+        if(a.costMs != b.costMs) return a.costMs < b.costMs;
+        return a.mode.fps > b.mode.fps;
+    });
+    return ranked;
+}
+
+const RankedCaptureMode* cheaperCaptureMode(
+    const std::vector<RankedCaptureMode>& ranked,
+    const CaptureMode& current
+) {
+    double currentCost = -1.0;
+    for(const auto& entry : ranked) {
+        if(entry.mode.index == current.index) {
+            currentCost = entry.costMs;
+            break;
+        }
+    }
+    if(currentCost < 0.0) return nullptr;
+
+    // Ranked order already puts the preferred one first
+    for(const auto& entry : ranked) {
+        if(entry.adequate && entry.costMs < currentCost) return &entry;
+    }
+    return nullptr;
+}
+
+/*
+** Selector
+*/
+CaptureModeSelector::CaptureModeSelector(const Config& config) :
+    config(config),
+    selected(false),
+    missing(false),
+    measuredMs(0.0),
+    switches(0) {}
+
+void CaptureModeSelector::setConfig(const Config& newConfig) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+}
+
+bool CaptureModeSelector::select(const std::vector<CaptureMode>& offered, CaptureMode& chosen) {
+    std::lock_guard<std::mutex> lock(mutex);
+    modes = offered;
+    std::vector<RankedCaptureMode> ranked = rankCaptureModes(modes, config.budget);
+    selected = !ranked.empty();
+    missing = false;
+    measuredMs = 0.0;
+    lastSwitch = Clock::now();
+    if(!selected) {
+        std::wcout << L"None of " << offered.size() << L" capture modes is usable" << std::endl;
+        return false;
+    }
+
+    const RankedCaptureMode& best = ranked.front();
+    current = best.mode;
+    chosen = current;
+    std::wcout << L"Capture mode " << current.width << L"x" << current.height << L" "
+               << pixelFormatName(current.pixelFormat) << L" at " << current.fps << L" fps, ~"
+               << best.costMs << L" ms per detection against " << config.budget.frameBudgetMs() << L" ms"
+               << (best.adequate ? L"" : L" (too small for the smallest face)") << std::endl;
+    return true;
+}
+
+/*
+** Report
+*/
+bool CaptureModeSelector::report(
+    const DetectionRateController::Metrics& rate,
+    const ScanQualityController::Metrics& quality,
+    CaptureMode& next
+) {
+    return report(rate, quality, Clock::now(), next);
+}
+
+bool CaptureModeSelector::report(
+    const DetectionRateController::Metrics& rate,
+    const ScanQualityController::Metrics& quality,
+    Clock::time_point now,
+    CaptureMode& next
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(!selected) return false;
+    if(rate.detectMs > 0.0) measuredMs = measuredMs > 0.0 ? measuredMs + SMOOTHING * (rate.detectMs - measuredMs) : rate.detectMs;
+
+    bool atFloor = quality.levelCount > 0 && quality.level + 1 == quality.levelCount && quality.overTarget;
+    bool overBudget = !rate.active && rate.budgetUsed > 1.0;
+    if(!atFloor && !overBudget) {
+        missing = false;
+        return false;
+    }
+    if(!missing) {
+        missing = true;
+        missingSince = now;
+    }
+
+    double settledMs = std::chrono::duration<double, std::milli>(now - lastSwitch).count();
+    double missedMs = std::chrono::duration<double, std::milli>(now - missingSince).count();
+    if(settledMs < config.settleMs || missedMs < config.holdMs) return false;
+
+    calibrate();
+    std::vector<RankedCaptureMode> ranked = rankCaptureModes(modes, config.budget);
+    const RankedCaptureMode* cheaper = cheaperCaptureMode(ranked, current);
+    // Nothing cheaper left: wait a full hold again before the next look
+    missingSince = now;
+    if(!cheaper) return false;
+
+    std::wcout << L"Capture mode " << current.width << L"x" << current.height << L" -> "
+               << cheaper->mode.width << L"x" << cheaper->mode.height << L" "
+               << pixelFormatName(cheaper->mode.pixelFormat) << L", measured " << measuredMs
+               << L" ms per detection" << std::endl;
+    current = cheaper->mode;
+    next = current;
+    lastSwitch = now;
+    missing = false;
+    measuredMs = 0.0;
+    switches++;
+    return true;
+}
+
+/*
+** Calibration
+**
+** The measured work covers conversion and scan; what is left after the
+** estimated conversion is put down to the scan. It is measured at
+** whatever rung the quality controller is on, so it reads low on the
+** coarse rungs, which only makes the next step a smaller one.
+*/
+void CaptureModeSelector::calibrate() {
+    double pixels = current.megapixels();
+    if(measuredMs <= 0.0 || pixels <= 0.0) return;
+
+    int decimation = (std::max)(config.budget.decimation, 1);
+    double scanMs = measuredMs - convertMs(current, config.budget);
+    double estimated = pixels / (decimation * decimation) * config.budget.scanMsPerMegapixel;
+    scanMs = (std::max)(scanMs, estimated * MIN_CALIBRATION);
+    config.budget.scanMsPerMegapixel = scanMs * decimation * decimation / pixels;
+}
+
+/*
+** Metrics
+*/
+CaptureModeSelector::Metrics CaptureModeSelector::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Metrics metrics;
+    metrics.mode = current;
+    metrics.estimatedMs = selected ? estimateCaptureCost(current, config.budget) : 0.0;
+    metrics.measuredMs = measuredMs;
+    metrics.scanMsPerMegapixel = config.budget.scanMsPerMegapixel;
+    metrics.missingTargets = missing;
+    metrics.switches = switches;
+    return metrics;
+}
+
+void CaptureModeSelector::logMetrics() const {
+    Metrics metrics = getMetrics();
+    std::wcout << L"Capture mode: " << metrics.mode.width << L"x" << metrics.mode.height << L" "
+               << pixelFormatName(metrics.mode.pixelFormat) << L", ~" << metrics.estimatedMs
+               << L" ms estimated, " << metrics.measuredMs << L" ms measured, "
+               << metrics.switches << L" switches" << (metrics.missingTargets ? L" (missing targets)" : L"") << std::endl;
+}
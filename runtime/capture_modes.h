@@ -0,0 +1,165 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "../source/frame_format.h"
+#include "detection_rate.h"
+#include "scan_quality.h"
+
+/*
+** What detection can afford per frame, and what it has to see. Costs
+** are estimates: scan work grows with the pixels left after decimation,
+** conversion with the bytes captured. The selector below corrects the
+** scan figure from measured times once frames are going through.
+*/
+struct CaptureBudget {
+    // Share of the wall clock detection may use, as in DetectionRateController
+    double cpuBudget;
+    // Detections per second the budget has to cover
+    double detectFps;
+    // Scan work per megapixel left after decimation
+    double scanMsPerMegapixel;
+    double convertMsPerMegabyte;
+    int decimation;
+    // Smallest face to find, as a share of the frame height
+    double minFaceFraction;
+    // Side of the cascade window
+    int windowSize;
+    // Below this the preview stutters
+    double minFps;
+
+    CaptureBudget(
+        double cpuBudget = 0.25,
+        double detectFps = 10.0,
+        double scanMsPerMegapixel = 40.0,
+        double convertMsPerMegabyte = 2.0,
+        int decimation = 1,
+        double minFaceFraction = 0.1,
+        int windowSize = 24,
+        double minFps = 15.0
+    ) :
+    cpuBudget(cpuBudget),
+    detectFps(detectFps),
+    scanMsPerMegapixel(scanMsPerMegapixel),
+    convertMsPerMegabyte(convertMsPerMegabyte),
+    decimation(decimation),
+    minFaceFraction(minFaceFraction),
+    windowSize(windowSize),
+    minFps(minFps) {}
+
+    // Work one detection may take
+    double frameBudgetMs() const {
+        return detectFps > 0.0 ? cpuBudget * 1000.0 / detectFps : 0.0;
+    }
+};
+
+struct RankedCaptureMode {
+    CaptureMode mode;
+    // Estimated work per detected frame
+    double costMs;
+    bool withinBudget;
+    // Resolves the smallest face and runs at minFps or better
+    bool adequate;
+};
+
+double estimateCaptureCost(const CaptureMode& mode, const CaptureBudget& budget);
+
+/*
+** Best first. Adequate modes within budget come first, largest first,
+** since more pixels find smaller and farther faces for the same
+** verdict. Then adequate modes over budget, cheapest first, then the
+** rest, largest first. Ties go to the cheaper format, then the higher
+** frame rate, then the source's own order. Modes in a format the
+** converter cannot read are left out.
+*/
+std::vector<RankedCaptureMode> rankCaptureModes(
+    const std::vector<CaptureMode>& modes,
+    const CaptureBudget& budget
+);
+
+// The best ranked adequate mode cheaper than `current`, null when there is none
+const RankedCaptureMode* cheaperCaptureMode(
+    const std::vector<RankedCaptureMode>& ranked,
+    const CaptureMode& current
+);
+
+/*
+** Chooses the capture mode when the source opens, then steps down to
+** a cheaper one while the pipeline keeps missing its targets.
+**
+** Targets count as missed when the scan quality controller is on its
+** last rung and still over its p95 target, or when detection is over
+** budget with the scene still, i.e. even the rate controller's longest
+** interval cannot absorb it. Once that has held for holdMs the scan
+** cost is recalibrated from the measured work and the best adequate
+** mode cheaper than the current one is asked for. After a switch the
+** other controllers get settleMs to find their footing before anything
+** counts again. There is no stepping back up; the next open ranks the
+** modes afresh.
+*/
+class CaptureModeSelector {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Config {
+            CaptureBudget budget;
+            double holdMs;
+            double settleMs;
+
+            Config(
+                const CaptureBudget& budget = CaptureBudget(),
+                double holdMs = 5000.0,
+                double settleMs = 10000.0
+            ) :
+            budget(budget),
+            holdMs(holdMs),
+            settleMs(settleMs) {}
+        };
+
+        struct Metrics {
+            CaptureMode mode;
+            double estimatedMs;
+            double measuredMs;
+            double scanMsPerMegapixel;
+            bool missingTargets;
+            uint64_t switches;
+        };
+
+        explicit CaptureModeSelector(const Config& config = Config());
+
+        void setConfig(const Config& config);
+
+        // Ranks what the source offers; false when it offers nothing usable
+        bool select(const std::vector<CaptureMode>& modes, CaptureMode& chosen);
+        // Called with every detection; true with `next` set when a cheaper mode should go in
+        bool report(
+            const DetectionRateController::Metrics& rate,
+            const ScanQualityController::Metrics& quality,
+            CaptureMode& next
+        );
+        bool report(
+            const DetectionRateController::Metrics& rate,
+            const ScanQualityController::Metrics& quality,
+            Clock::time_point now,
+            CaptureMode& next
+        );
+
+        Metrics getMetrics() const;
+        void logMetrics() const;
+
+    private:
+        Config config;
+        mutable std::mutex mutex;
+
+        std::vector<CaptureMode> modes;
+        CaptureMode current;
+        bool selected;
+        Clock::time_point lastSwitch;
+        Clock::time_point missingSince;
+        bool missing;
+        double measuredMs;
+        uint64_t switches;
+
+        void calibrate();
+};
@@ -0,0 +1,208 @@
+#include "deadline_scheduler.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    const double SERVICE_SMOOTHING = 0.2;
+
+    DeadlineScheduler::Clock::duration period(double fps) {
+        return std::chrono::duration_cast<DeadlineScheduler::Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+    }
+
+    double toMs(DeadlineScheduler::Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+DeadlineScheduler::DeadlineScheduler(ThreadPool& pool, size_t maxInFlight) :
+    maxInFlight(maxInFlight > 0 ? maxInFlight : pool.size()),
+    inFlight(0) {}
+
+DeadlineScheduler::~DeadlineScheduler() {
+    for(size_t i = 0; i < sources.size(); i++) clear(i);
+    for(auto& source : sources) {
+        source->stages->drain();
+        source->stages->setDoneCallback(nullptr);
+    }
+}
+
+size_t DeadlineScheduler::addSource(
+    DetectionStages& stages,
+    double targetFps,
+    size_t perSourceInFlight
+) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index = sources.size();
+    std::unique_ptr<Source> source(new Source());
+    source->stages = &stages;
+    source->targetFps = targetFps > 0 ? targetFps : 15.0;
+    source->maxInFlight = (std::max)(perSourceInFlight, static_cast<size_t>(1));
+    source->anchored = false;
+    source->stats = SourceStats();
+    source->stats.targetFps = source->targetFps;
+    sources.push_back(std::move(source));
+
+    stages.setDoneCallback([this, index]() {
+        finished(index);
+    });
+    return index;
+}
+
+void DeadlineScheduler::setTargetRate(size_t source, double targetFps) {
+    if(targetFps <= 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    sources[source]->targetFps = targetFps;
+    sources[source]->stats.targetFps = targetFps;
+}
+
+/*
+** Capture Time
+**
+** Source timestamps start wherever the device likes; the first frame
+** pins them to the steady clock. A source running ahead of real time
+** (a file read as fast as possible) is pulled back to now.
+*/
+DeadlineScheduler::Clock::time_point DeadlineScheduler::captureTime(
+    Source& source,
+    int64_t timestamp,
+    Clock::time_point now
+) {
+    // Timestamps are in 100 ns units
+    Clock::duration offset = std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timestamp * 100));
+    Clock::time_point captured = source.origin + offset;
+    if(!source.anchored || captured > now) {
+        source.origin = now - offset;
+        source.anchored = true;
+        captured = now;
+    }
+    return captured;
+}
+
+/*
+** Submit
+*/
+void DeadlineScheduler::submit(size_t index, const FrameHandle& frame) {
+    if(!frame) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Source& source = *sources[index];
+        source.stats.submitted++;
+
+        Clock::time_point now = Clock::now();
+        Pending pending;
+        pending.frame = frame;
+        pending.deadline = captureTime(source, frame->timestamp, now) + period(source.targetFps);
+        if(source.waiting.size() >= QUEUE_LIMIT) {
+            source.waiting.pop_front();
+            source.stats.dropped++;
+        }
+        source.waiting.push_back(pending);
+    }
+    dispatch();
+}
+
+void DeadlineScheduler::clear(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Source& source = *sources[index];
+    source.stats.dropped += source.waiting.size();
+    source.waiting.clear();
+}
+
+/*
+** Dispatch
+**
+** Frames are handed to the stages outside the lock: with a one-thread
+** pool the whole detection, and with it finished(), runs inside submit.
+*/
+void DeadlineScheduler::dispatch() {
+    for(;;) {
+        size_t chosen = 0;
+        FrameHandle frame;
+        DetectionStages* stages = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(inFlight >= maxInFlight) return;
+
+            Clock::time_point now = Clock::now();
+            Source* best = nullptr;
+            for(size_t i = 0; i < sources.size(); i++) {
+                Source& source = *sources[i];
+                if(source.inFlight.size() >= source.maxInFlight) continue;
+
+                Clock::duration expected = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double, std::milli>(source.stats.serviceMs)
+                );
+                while(source.waiting.size() > 1 && now + expected > source.waiting.front().deadline) {
+                    source.waiting.pop_front();
+                    source.stats.dropped++;
+                }
+                if(source.waiting.empty()) continue;
+                if(!best || source.waiting.front().deadline < best->waiting.front().deadline) {
+                    best = &source;
+                    chosen = i;
+                }
+            }
+            if(!best) return;
+
+            Pending next = std::move(best->waiting.front());
+            best->waiting.pop_front();
+            best->inFlight.push_back(std::make_pair(next.deadline, now));
+            best->stats.dispatched++;
+            inFlight++;
+            frame = std::move(next.frame);
+            stages = best->stages;
+        }
+        // The scheduler already chose the frame worth running, and the per-source limit
+        // keeps it within the first queue, so this neither drops nor waits
+        if(!stages->submit(frame, true)) finished(chosen);
+    }
+}
+
+void DeadlineScheduler::finished(size_t index) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Source& source = *sources[index];
+        if(source.inFlight.empty()) return;
+
+        Clock::time_point now = Clock::now();
+        Clock::time_point deadline = source.inFlight.front().first;
+        Clock::time_point started = source.inFlight.front().second;
+        source.inFlight.pop_front();
+        inFlight--;
+
+        SourceStats& stats = source.stats;
+        double serviceMs = toMs(now - started);
+        stats.serviceMs = stats.completed == 0 ? serviceMs : stats.serviceMs + SERVICE_SMOOTHING * (serviceMs - stats.serviceMs);
+        stats.completed++;
+
+        double latenessMs = toMs(now - deadline);
+        if(latenessMs > 0) {
+            stats.late++;
+            stats.totalLatenessMs += latenessMs;
+            stats.maxLatenessMs = (std::max)(stats.maxLatenessMs, latenessMs);
+        }
+    }
+    dispatch();
+}
+
+/*
+** Stats
+*/
+DeadlineScheduler::SourceStats DeadlineScheduler::getStats(size_t source) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return sources[source]->stats;
+}
+
+void DeadlineScheduler::logStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::wcout << L"Deadline scheduler, " << maxInFlight << L" frames in flight:" << std::endl;
+    for(size_t i = 0; i < sources.size(); i++) {
+        const SourceStats& stats = sources[i]->stats;
+        double meanLateness = stats.late ? stats.totalLatenessMs / stats.late : 0.0;
+        std::wcout << L"  source " << i << L" @ " << stats.targetFps << L" fps: "
+                   << stats.submitted << L" submitted, " << stats.completed << L" done, "
+                   << stats.dropped << L" dropped, " << stats.late << L" late ("
+                   << meanLateness << L" ms mean, " << stats.maxLatenessMs << L" ms max), "
+                   << stats.serviceMs << L" ms service" << std::endl;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../source/frame_pool.h"
+#include "detection_stages.h"
+
+/*
+** Earliest-deadline-first admission of live frames into detection.
+**
+** Every frame gets a deadline of its capture time plus one period of
+** its source's target detection rate. Frames wait here, per source,
+** and at most maxInFlight of them are inside detection at once across
+** all sources; whenever one finishes, the waiting frame with the
+** earliest deadline goes next. A busy camera therefore cannot starve
+** the others, and a slow one only falls behind by its own frames.
+**
+** A frame that can no longer make its deadline, judged by the source's
+** recent detection time, is dropped when a newer frame of the same
+** source is waiting to take its place. The newest frame always runs,
+** late or not, so a source slower than its target still makes progress
+** and shows up in the lateness counters instead of going dark.
+*/
+class DeadlineScheduler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct SourceStats {
+            double targetFps;
+            uint64_t submitted;
+            uint64_t dispatched;
+            uint64_t completed;
+            // Expired while waiting, or pushed out of a full queue
+            uint64_t dropped;
+            // Finished after their deadline
+            uint64_t late;
+            double totalLatenessMs;
+            double maxLatenessMs;
+            // Recent dispatch to finish time, used to predict misses
+            double serviceMs;
+        };
+
+        // Frames waiting per source before the oldest is pushed out
+        static const size_t QUEUE_LIMIT = 4;
+
+        // 0 in flight means one per pool thread
+        DeadlineScheduler(ThreadPool& pool, size_t maxInFlight = 0);
+        ~DeadlineScheduler();
+
+        DeadlineScheduler(const DeadlineScheduler&) = delete;
+        DeadlineScheduler& operator=(const DeadlineScheduler&) = delete;
+
+        /*
+        ** The stages must not be fed by anyone else and must outlive the
+        ** scheduler; at most their queue depth of frames is sent at once.
+        */
+        size_t addSource(
+            DetectionStages& stages,
+            double targetFps = 15.0,
+            size_t perSourceInFlight = 2
+        );
+        void setTargetRate(size_t source, double targetFps);
+
+        void submit(size_t source, const FrameHandle& frame);
+        // Drops every frame still waiting, in-flight frames finish normally
+        void clear(size_t source);
+
+        SourceStats getStats(size_t source) const;
+        void logStats() const;
+
+    private:
+        struct Pending {
+            FrameHandle frame;
+            Clock::time_point deadline;
+        };
+        struct Source {
+            DetectionStages* stages;
+            double targetFps;
+            size_t maxInFlight;
+            // Steady clock time of source timestamp zero, set by the first frame
+            Clock::time_point origin;
+            bool anchored;
+            std::deque<Pending> waiting;
+            // Deadline and dispatch time of frames inside detection, oldest first
+            std::deque<std::pair<Clock::time_point, Clock::time_point>> inFlight;
+            SourceStats stats;
+        };
+
+        size_t maxInFlight;
+        size_t inFlight;
+        std::vector<std::unique_ptr<Source>> sources;
+        mutable std::mutex mutex;
+
+        Clock::time_point captureTime(Source& source, int64_t timestamp, Clock::time_point now);
+        void finished(size_t source);
+        void dispatch();
+};
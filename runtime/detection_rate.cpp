@@ -0,0 +1,134 @@
+#include "detection_rate.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "../kernels/pixel_kernels.h"
+
+namespace {
+    const int MOTION_ROW_STEP = 8;
+    const double SMOOTHING = 0.2;
+
+    double smooth(double current, double sample, bool first) {
+        return first ? sample : current + SMOOTHING * (sample - current);
+    }
+}
+
+DetectionRateController::DetectionRateController(const Config& config) :
+    config(config),
+    referenceFormat(PixelFormat::Unknown),
+    referenceWidth(0),
+    referenceHeight(0),
+    detectedBefore(false),
+    detectMs(0.0),
+    meanIntervalMs(0.0),
+    motion(0.0),
+    facesChanged(false),
+    lastFaceCount(0),
+    framesOffered(0),
+    framesDetected(0) {}
+
+void DetectionRateController::setConfig(const Config& newConfig) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+}
+
+DetectionRateController::Config DetectionRateController::getConfig() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+/*
+** Motion
+*/
+double DetectionRateController::measureMotion(const FrameView& frame) {
+    int rowBytes = frame.width * pixelFormatBytes(frame.format);
+    int rows = (frame.height + MOTION_ROW_STEP - 1) / MOTION_ROW_STEP;
+    size_t sampledStride = frame.stride * MOTION_ROW_STEP;
+    if(rowBytes <= 0 || rows <= 0) return 0.0;
+
+    bool sameLayout = frame.format == referenceFormat &&
+        frame.width == referenceWidth &&
+        frame.height == referenceHeight;
+    double result = 0.0;
+    if(sameLayout) {
+        uint32_t sad = PixelKernels::blockDiff(frame.data, sampledStride, reference.data(), rowBytes, rowBytes, rows);
+        result = static_cast<double>(sad) / (static_cast<double>(rowBytes) * rows);
+    }
+
+    reference.resize(static_cast<size_t>(rowBytes) * rows);
+    for(int i = 0; i < rows; i++) {
+        std::memcpy(&reference[static_cast<size_t>(i) * rowBytes], frame.row(i * MOTION_ROW_STEP), rowBytes);
+    }
+    referenceFormat = frame.format;
+    referenceWidth = frame.width;
+    referenceHeight = frame.height;
+    return result;
+}
+
+/*
+** Interval
+*/
+double DetectionRateController::targetInterval(bool active) const {
+    // No measurement yet: detect as soon as allowed to learn the cost
+    if(!detectedBefore || detectMs <= 0.0) return config.minIntervalMs;
+
+    double budget = config.cpuBudget * (active ? config.activeBoost : 1.0);
+    double interval = budget > 0.0 ? detectMs / budget : config.maxIntervalMs;
+    return (std::min)((std::max)(interval, config.minIntervalMs), config.maxIntervalMs);
+}
+
+bool DetectionRateController::shouldDetect(const FrameView& frame) {
+    return shouldDetect(frame, Clock::now());
+}
+
+bool DetectionRateController::shouldDetect(const FrameView& frame, Clock::time_point now) {
+    if(frame.empty()) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    framesOffered++;
+    motion = measureMotion(frame);
+
+    bool active = motion > config.motionThreshold || facesChanged;
+    double elapsedMs = std::chrono::duration<double, std::milli>(now - lastDetect).count();
+    if(framesDetected > 0 && elapsedMs < targetInterval(active)) return false;
+
+    if(framesDetected > 0) meanIntervalMs = smooth(meanIntervalMs, elapsedMs, framesDetected == 1);
+    lastDetect = now;
+    framesDetected++;
+    facesChanged = false;
+    return true;
+}
+
+void DetectionRateController::reportDetection(double ms, size_t faceCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    detectMs = smooth(detectMs, ms, !detectedBefore);
+    if(detectedBefore && faceCount != lastFaceCount) facesChanged = true;
+    lastFaceCount = faceCount;
+    detectedBefore = true;
+}
+
+/*
+** Metrics
+*/
+DetectionRateController::Metrics DetectionRateController::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Metrics metrics;
+    metrics.active = motion > config.motionThreshold || facesChanged;
+    metrics.intervalMs = targetInterval(metrics.active);
+    metrics.effectiveFps = meanIntervalMs > 0.0 ? 1000.0 / meanIntervalMs : 0.0;
+    metrics.detectMs = detectMs;
+    metrics.budgetUsed = meanIntervalMs > 0.0 && config.cpuBudget > 0.0 ? detectMs / meanIntervalMs / config.cpuBudget : 0.0;
+    metrics.motion = motion;
+    metrics.framesOffered = framesOffered;
+    metrics.framesDetected = framesDetected;
+    return metrics;
+}
+
+void DetectionRateController::logMetrics() const {
+    Metrics metrics = getMetrics();
+    std::wcout << L"Detection rate: " << metrics.effectiveFps << L" fps ("
+               << metrics.framesDetected << L" of " << metrics.framesOffered << L" frames), "
+               << metrics.detectMs << L" ms per frame, "
+               << metrics.budgetUsed * 100.0 << L"% of budget, interval "
+               << metrics.intervalMs << L" ms" << (metrics.active ? L" (active)" : L"") << std::endl;
+}
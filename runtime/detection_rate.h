@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "../source/frame.h"
+
+/*
+** Decides which captured frames get detected, from what detection
+** actually costs rather than a fixed interval.
+**
+** Detection may use a set share of the wall clock (the budget): a
+** frame costing 20 ms against a 0.25 budget is detected every 80 ms.
+** While the scene is moving, or the last detection changed the face
+** count, the budget is multiplied by activeBoost so changes are picked
+** up sooner; a still scene falls back to the plain budget. The interval
+** is kept within [minIntervalMs, maxIntervalMs] either way.
+**
+** Motion is the mean absolute difference between consecutive frames
+** over every eighth row, so checking a frame costs a fraction of
+** converting it. Packed formats are compared byte for byte, which
+** counts chroma along with luma; that is fine for telling still from
+** moving.
+*/
+class DetectionRateController {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Config {
+            // Share of the wall clock detection may use for this source
+            double cpuBudget;
+            double minIntervalMs;
+            double maxIntervalMs;
+            // Mean absolute difference per byte above which the scene is moving
+            double motionThreshold;
+            double activeBoost;
+
+            Config(
+                double cpuBudget = 0.25,
+                double minIntervalMs = 33.0,
+                double maxIntervalMs = 1000.0,
+                double motionThreshold = 4.0,
+                double activeBoost = 3.0
+            ) :
+            cpuBudget(cpuBudget),
+            minIntervalMs(minIntervalMs),
+            maxIntervalMs(maxIntervalMs),
+            motionThreshold(motionThreshold),
+            activeBoost(activeBoost) {}
+        };
+
+        struct Metrics {
+            // Interval the controller is currently aiming for
+            double intervalMs;
+            double effectiveFps;
+            // Smoothed work per detected frame
+            double detectMs;
+            // Detection time over wall time, as a fraction of the plain budget; above 1 while boosted
+            double budgetUsed;
+            double motion;
+            bool active;
+            uint64_t framesOffered;
+            uint64_t framesDetected;
+        };
+
+        explicit DetectionRateController(const Config& config = Config());
+
+        void setConfig(const Config& config);
+        Config getConfig() const;
+
+        // Called for every captured frame; true when this one should be detected
+        bool shouldDetect(const FrameView& frame);
+        bool shouldDetect(const FrameView& frame, Clock::time_point now);
+        // Work the detection took, and what it found
+        void reportDetection(double detectMs, size_t faceCount);
+
+        Metrics getMetrics() const;
+        void logMetrics() const;
+
+    private:
+        Config config;
+        mutable std::mutex mutex;
+
+        std::vector<uint8_t> reference;
+        PixelFormat referenceFormat;
+        int referenceWidth;
+        int referenceHeight;
+
+        Clock::time_point lastDetect;
+        bool detectedBefore;
+        double detectMs;
+        double meanIntervalMs;
+        double motion;
+        bool facesChanged;
+        size_t lastFaceCount;
+        uint64_t framesOffered;
+        uint64_t framesDetected;
+
+        double measureMotion(const FrameView& frame);
+        double targetInterval(bool active) const;
+};
@@ -0,0 +1,272 @@
+#include "detection_stages.h"
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    const size_t STAGE_COUNT = 4;
+}
+
+DetectionStages::DetectionStages(
+    const HaarCascade& cascade,
+    ThreadPool& pool,
+    size_t queueDepth
+) :
+    useSquaredIntegral(false),
+    exclusionMask(nullptr),
+    scaleMap(nullptr),
+    qualityController(nullptr),
+    cascade(cascade),
+    pool(pool),
+    frameConverter(&pool),
+    grouper(cascade.grouper),
+    dropped(0),
+    liveInside(0),
+    feedRequests(0),
+    tasks(pool)
+{
+    if(queueDepth == 0) queueDepth = 1;
+
+    // Each stage adds its own time to the frame, so a result knows what it cost
+    auto timed = [this](void (DetectionStages::*step)(Item&)) {
+        return [this, step](Item& item) {
+            auto start = std::chrono::steady_clock::now();
+            (this->*step)(item);
+            item.result.workMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+    };
+    stages.emplace_back(new PipelineStage<Item>(L"integral", queueDepth, tasks, timed(&DetectionStages::integrate)));
+    stages.emplace_back(new PipelineStage<Item>(L"scan", queueDepth, tasks, timed(&DetectionStages::scan)));
+    stages.emplace_back(new PipelineStage<Item>(L"group", queueDepth, tasks, timed(&DetectionStages::group)));
+    stages.emplace_back(new PipelineStage<Item>(L"publish", queueDepth, tasks, timed(&DetectionStages::publish)));
+    for(size_t i = 0; i + 1 < stages.size(); i++) {
+        stages[i]->connect(stages[i + 1].get());
+    }
+    stages.back()->setSink([this](Item* item) {
+        recycle(item);
+    });
+
+    // Queued, running and held back at every stage: submit() never runs out
+    size_t itemCount = STAGE_COUNT * (queueDepth + 2);
+    for(size_t i = 0; i < itemCount; i++) {
+        items.emplace_back(new Item());
+        freeItems.push_back(items.back().get());
+    }
+}
+
+DetectionStages::~DetectionStages() {
+    drain();
+}
+
+void DetectionStages::setResultCallback(ResultCallback callback) {
+    resultCallback = callback;
+}
+
+void DetectionStages::setDoneCallback(std::function<void()> callback) {
+    doneCallback = callback;
+}
+
+/*
+** Submit
+*/
+bool DetectionStages::submit(
+    const FrameHandle& frame,
+    bool wait,
+    Completion completion
+) {
+    if(!frame) return false;
+
+    Item* item = acquireItem();
+    if(!item) {
+        dropped++;
+        return false;
+    }
+    item->frame = frame;
+    item->config = scanConfig;
+    item->squared = useSquaredIntegral;
+    item->mask = exclusionMask;
+    item->map = scaleMap;
+    item->quality = qualityController;
+    item->qualityRung = 0;
+    item->failed = false;
+    item->live = !wait;
+    item->plan.reset();
+    item->result.sequence = frame->sequence;
+    item->result.timestamp = frame->timestamp;
+    item->result.width = frame->width;
+    item->result.height = frame->height;
+    item->result.faces.clear();
+    item->result.detected = false;
+    item->result.workMs = 0.0;
+    item->submitted = std::chrono::steady_clock::now();
+    item->completion = completion;
+
+    if(wait) {
+        stages.front()->pushWait(item);
+        return true;
+    }
+
+    // The mailbox counts the one it replaces as dropped
+    Item* replaced = liveWaiting.publish(item);
+    if(replaced) {
+        // It never got in, so it leaves no room behind
+        replaced->live = false;
+        recycle(replaced);
+    }
+    feed();
+    return true;
+}
+
+/*
+** Feed
+**
+** Moves the waiting live frame into the stages while fewer than
+** LIVE_FRAMES are inside. Called after every live submit and whenever a
+** live frame leaves, from any thread; the first caller to find no feed
+** running becomes the mailbox's one consumer and also serves the calls
+** that come in while it is at it, so nothing here ever waits.
+*/
+void DetectionStages::feed() {
+    if(feedRequests.fetch_add(1) != 0) return;
+
+    unsigned served = 1;
+    for(;;) {
+        while(liveInside.load() < LIVE_FRAMES) {
+            Item* item = liveWaiting.take();
+            if(!item) break;
+            liveInside++;
+            enter(item);
+        }
+        unsigned requested = feedRequests.fetch_sub(served);
+        if(requested == served) return;
+        served = requested - served;
+    }
+}
+
+/*
+** Offline frames may have filled the first queue, in which case the
+** live one is dropped rather than waited for.
+*/
+void DetectionStages::enter(Item* item) {
+    if(stages.front()->tryPush(item)) return;
+    dropped++;
+    recycle(item);
+}
+
+void DetectionStages::drain() {
+    for(;;) {
+        tasks.wait();
+        bool idle = !liveWaiting.hasNew();
+        for(const auto& stage : stages) {
+            if(!stage->idle()) idle = false;
+        }
+        if(idle) return;
+    }
+}
+
+DetectionStages::Item* DetectionStages::acquireItem() {
+    std::lock_guard<std::mutex> lock(itemMutex);
+    if(freeItems.empty()) return nullptr;
+    Item* item = freeItems.back();
+    freeItems.pop_back();
+    return item;
+}
+
+void DetectionStages::recycle(Item* item) {
+    if(item->completion) {
+        Completion completion;
+        completion.swap(item->completion);
+        completion(item->result);
+    }
+    item->frame.reset();
+    item->plan.reset();
+
+    bool live = item->live;
+    {
+        std::lock_guard<std::mutex> lock(itemMutex);
+        freeItems.push_back(item);
+    }
+    if(doneCallback) doneCallback();
+
+    // A live frame leaving makes room for the one waiting, if any
+    if(live) {
+        liveInside--;
+        feed();
+    }
+}
+
+/*
+** Stages
+*/
+void DetectionStages::integrate(Item& item) {
+    if(item.quality) item.config = item.quality->configFor(item.config, &item.qualityRung);
+
+    // Packed frames are read once, luma and integral in the same pass; planar ones from their luma plane
+    bool converted = frameConverter.convertToIntegral(item.frame.view(), item.integral, item.squared, item.config.decimation);
+    // The source bytes are done with, hand the buffer back to capture
+    item.frame.reset();
+    if(!converted) {
+        item.failed = true;
+        return;
+    }
+
+    const IntegralImage& integral = item.integral;
+    if(!windowPlan || !windowPlan->matches(integral.width, integral.height, cascade.baseWidth, item.config, item.mask, item.map)) {
+        // A new plan rather than a rebuild: frames further down still scan the old one
+        std::shared_ptr<WindowPlan> plan = std::make_shared<WindowPlan>();
+        plan->build(integral.width, integral.height, cascade.baseWidth, item.config, item.mask, item.map);
+        windowPlan = plan;
+    }
+    item.plan = windowPlan;
+}
+
+void DetectionStages::scan(Item& item) {
+    if(item.failed) return;
+    if(!cascade.scanWindows(item.integral, *item.plan, item.candidates, &pool)) item.failed = true;
+}
+
+void DetectionStages::group(Item& item) {
+    if(item.failed) return;
+
+    grouper.minNeighbours = cascade.grouper.minNeighbours;
+    grouper.eps = cascade.grouper.eps;
+    item.result.faces = grouper.group(item.candidates);
+    HaarCascade::scaleToFrame(item.result.faces, item.config.decimation);
+}
+
+void DetectionStages::publish(Item& item) {
+    if(item.failed) return;
+
+    item.result.detectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - item.submitted).count();
+    if(item.quality) item.quality->report(item.result.workMs, item.qualityRung);
+    item.result.detected = true;
+    if(resultCallback) resultCallback(item.result);
+}
+
+/*
+** Stats
+*/
+std::vector<DetectionStages::StageStats> DetectionStages::getStats() const {
+    std::vector<StageStats> result;
+    for(const auto& stage : stages) {
+        result.push_back(stage->getStats());
+    }
+    return result;
+}
+
+void DetectionStages::logStats() const {
+    std::ios_base::fmtflags flags = std::wcout.flags();
+    std::streamsize precision = std::wcout.precision();
+    for(const auto& stage : getStats()) {
+        std::wcout << L"  " << std::left << std::setw(9) << stage.name << std::right
+                   << stage.processed << L" frames, "
+                   << std::fixed << std::setprecision(2)
+                   << stage.meanServiceMs() << L" ms mean, "
+                   << stage.maxServiceMs << L" ms max, depth "
+                   << stage.depth << L"/" << stage.capacity
+                   << L" (peak " << stage.maxDepth << L"), blocked "
+                   << stage.blocked << std::endl;
+    }
+    std::wcout << L"  dropped  " << getDropped() << std::endl;
+    std::wcout.flags(flags);
+    std::wcout.precision(precision);
+}
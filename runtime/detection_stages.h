@@ -0,0 +1,175 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../classifier/detection_grouper.h"
+#include "../classifier/exclusion_mask.h"
+#include "../classifier/haar_cascade.h"
+#include "../classifier/integral_image.h"
+#include "../classifier/scale_map.h"
+#include "../classifier/window_plan.h"
+#include "../source/frame_converter.h"
+#include "../source/frame_mailbox.h"
+#include "../source/frame_pool.h"
+#include "pipeline_stage.h"
+#include "scan_quality.h"
+#include "thread_pool.h"
+
+struct PipelineResult {
+    // Index of the frame in the source, counting dropped frames too
+    uint64_t sequence;
+    int64_t timestamp;
+    // Size of the frame the faces are in
+    int width;
+    int height;
+    std::vector<Rect> faces;
+    // False when the frame was dropped or could not be detected; faces are empty then
+    bool detected;
+    // From submit() to publish, queueing included
+    double detectMs;
+    // Time spent in the stages themselves, queueing excluded
+    double workMs;
+};
+
+/*
+** Detection split into stages that overlap across frames:
+**
+**   integral -> scan -> group -> publish
+**
+** Conversion has no stage of its own: the integral stage reads packed
+** frames through the fused luma and integral kernels, so no grayscale
+** copy of the frame is ever made. Each stage works on one frame at a
+** time, in order, so frame N+1 is integrated while frame N is still
+** being scanned, and throughput is set by the slowest stage instead of
+** the sum of them.
+** Queues between stages are bounded; when one fills up the stages
+** before it stall and an offline submit() waits for room.
+**
+** Live frames would only go stale in those queues, so no more than
+** LIVE_FRAMES of them are let into the stages at once: one being
+** scanned and one being prepared behind it. A frame submitted past that
+** waits in a lock-free latest-frame mailbox, where the next one replaces
+** it, so whatever stage is the bottleneck picks up the newest frame
+** there is once it frees up.
+**
+** The scan fans its bands out over the same pool, so a lone slow stage
+** still uses every core. The cascade is only read; grouping has its own
+** DetectionGrouper, since the grouper keeps scratch state.
+*/
+class DetectionStages {
+    public:
+        typedef std::function<void(const PipelineResult&)> ResultCallback;
+        // Follows one frame; called once as it leaves, see submit()
+        typedef std::function<void(const PipelineResult&)> Completion;
+
+        struct Item {
+            FrameHandle frame;
+            ScanConfig config;
+            bool squared;
+            const ExclusionMask* mask;
+            const ScaleMap* map;
+            ScanQualityController* quality;
+            size_t qualityRung;
+            // Set by the stage that gave up on the frame; later stages pass it through
+            bool failed;
+            // Counts against LIVE_FRAMES until recycled
+            bool live;
+            IntegralImage integral;
+            std::shared_ptr<const WindowPlan> plan;
+            std::vector<Rect> candidates;
+            PipelineResult result;
+            std::chrono::steady_clock::time_point submitted;
+            Completion completion;
+        };
+        typedef PipelineStage<Item>::Stats StageStats;
+
+        // Live frames inside the stages at once
+        static const size_t LIVE_FRAMES = 2;
+
+        // Read at submit(); change them between frames from the submitting thread only
+        ScanConfig scanConfig;
+        bool useSquaredIntegral;
+        const ExclusionMask* exclusionMask;
+        const ScaleMap* scaleMap;
+        // When set, coarsens scanConfig under load; fed the work time of every frame
+        ScanQualityController* qualityController;
+
+        DetectionStages(
+            const HaarCascade& cascade,
+            ThreadPool& pool,
+            size_t queueDepth = 2
+        );
+        ~DetectionStages();
+
+        DetectionStages(const DetectionStages&) = delete;
+        DetectionStages& operator=(const DetectionStages&) = delete;
+
+        // Called from the publish stage, one frame at a time and in order
+        void setResultCallback(ResultCallback callback);
+        // Called once for every submitted frame as it leaves: published, failed or dropped
+        void setDoneCallback(std::function<void()> callback);
+
+        /*
+        ** Queue a frame. With wait the call blocks until the first stage
+        ** has room. Without it the frame is live: it goes into a
+        ** latest-frame mailbox, replacing (and dropping) the live frame
+        ** still waiting there, and is let in as soon as fewer than
+        ** LIVE_FRAMES are inside. Live frames come from one thread at a
+        ** time, the mailbox's single producer.
+        ** A completion is called exactly once for a frame submit() took,
+        ** with the published result, or with detected unset when the
+        ** frame was dropped or failed. It runs on whichever thread let
+        ** the frame go, before its slot is reused.
+        */
+        bool submit(
+            const FrameHandle& frame,
+            bool wait,
+            Completion completion = Completion()
+        );
+        // Blocks until every submitted frame is published or dropped
+        void drain();
+
+        std::vector<StageStats> getStats() const;
+        uint64_t getDropped() const {
+            return dropped.load() + liveWaiting.dropped();
+        }
+        void logStats() const;
+
+    private:
+        const HaarCascade& cascade;
+        ThreadPool& pool;
+        FrameConverter frameConverter;
+        DetectionGrouper grouper;
+        ResultCallback resultCallback;
+        std::function<void()> doneCallback;
+        // Only touched by the integral stage
+        std::shared_ptr<const WindowPlan> windowPlan;
+
+        std::vector<std::unique_ptr<Item>> items;
+        std::vector<Item*> freeItems;
+        std::mutex itemMutex;
+        std::atomic<uint64_t> dropped;
+
+        // The newest live frame not let in yet; submit() is its producer, feed() its consumer
+        FrameMailbox<Item*> liveWaiting;
+        std::atomic<size_t> liveInside;
+        std::atomic<unsigned> feedRequests;
+
+        TaskGroup tasks;
+        std::vector<std::unique_ptr<PipelineStage<Item>>> stages;
+
+        Item* acquireItem();
+        void feed();
+        void enter(Item* item);
+        void recycle(Item* item);
+
+        void integrate(Item& item);
+        void scan(Item& item);
+        void group(Item& item);
+        void publish(Item& item);
+};
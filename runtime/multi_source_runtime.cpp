@@ -0,0 +1,132 @@
+#include "multi_source_runtime.h"
+#include <iostream>
+#include <thread>
+
+MultiSourceRuntime::MultiSourceRuntime(
+    const HaarCascade& cascade,
+    ThreadPool* pool,
+    size_t queueDepth
+) :
+    useSquaredIntegral(false),
+    cascade(cascade),
+    pool(pool ? *pool : ThreadPool::shared()),
+    queueDepth(queueDepth),
+    scheduler(this->pool) {}
+
+MultiSourceRuntime::~MultiSourceRuntime() {
+    stop();
+}
+
+size_t MultiSourceRuntime::addSource(
+    IFrameSource& source,
+    double targetFps
+) {
+    size_t index = pipelines.size();
+    sources.push_back(&source);
+    pipelines.emplace_back(new Pipeline(source, cascade, &pool, queueDepth));
+    Pipeline& pipeline = *pipelines.back();
+    pipeline.setResultCallback([this, index](const PipelineResult& result) {
+        if(resultCallback) resultCallback(index, result);
+    });
+
+    int slot = -1;
+    if(source.isLive()) {
+        slot = static_cast<int>(scheduler.addSource(pipeline.getStages(), targetFps, queueDepth));
+        pipeline.setScheduler(&scheduler, slot);
+    }
+    schedulerSlots.push_back(slot);
+    return index;
+}
+
+void MultiSourceRuntime::setTargetRate(size_t index, double targetFps) {
+    if(schedulerSlots[index] >= 0) scheduler.setTargetRate(schedulerSlots[index], targetFps);
+}
+
+void MultiSourceRuntime::setRateControl(size_t index, const DetectionRateController::Config& config) {
+    pipelines[index]->setRateControl(config);
+}
+
+void MultiSourceRuntime::setQualityControl(size_t index, const ScanQualityController::Config& config) {
+    pipelines[index]->setQualityControl(config);
+}
+
+void MultiSourceRuntime::setResultCallback(ResultCallback callback) {
+    resultCallback = callback;
+}
+
+/*
+** Run
+*/
+bool MultiSourceRuntime::run(uint64_t maxFramesPerSource) {
+    if(pipelines.empty()) {
+        std::wcout << L"No sources to run" << std::endl;
+        return false;
+    }
+    std::wcout << L"Running " << pipelines.size() << L" sources on "
+               << pool.size() << L" threads" << std::endl;
+
+    std::vector<char> results(pipelines.size(), 0);
+    std::vector<std::thread> readers;
+    for(size_t i = 0; i < pipelines.size(); i++) {
+        Pipeline& pipeline = *pipelines[i];
+        pipeline.scanConfig = scanConfig;
+        pipeline.useSquaredIntegral = useSquaredIntegral;
+        readers.emplace_back([&pipeline, &results, i, maxFramesPerSource]() {
+            results[i] = pipeline.run(maxFramesPerSource) ? 1 : 0;
+        });
+    }
+    for(auto& reader : readers) reader.join();
+
+    bool result = true;
+    for(size_t i = 0; i < results.size(); i++) {
+        if(results[i]) continue;
+        std::wcout << L"Source " << i << L" (" << sources[i]->getName() << L") failed" << std::endl;
+        result = false;
+    }
+    return result;
+}
+
+void MultiSourceRuntime::stop() {
+    for(auto& pipeline : pipelines) pipeline->stop();
+}
+
+/*
+** Stats
+*/
+Pipeline::Stats MultiSourceRuntime::getStats(size_t index) const {
+    return pipelines[index]->getStats();
+}
+
+std::vector<Rect> MultiSourceRuntime::getLatestFaces(size_t index) const {
+    return pipelines[index]->getLatestFaces();
+}
+
+void MultiSourceRuntime::logStats() const {
+    for(size_t i = 0; i < pipelines.size(); i++) {
+        Pipeline::Stats stats = pipelines[i]->getStats();
+        double meanMs = stats.framesProcessed ? stats.totalDetectMs / stats.framesProcessed : 0.0;
+        double fps = stats.elapsedSeconds > 0 ? stats.framesProcessed / stats.elapsedSeconds : 0.0;
+        std::wcout << L"Source " << i << L" (" << sources[i]->getName() << L"): "
+                   << stats.framesRead << L" read, " << stats.framesProcessed << L" processed, "
+                   << stats.framesDropped << L" dropped, " << stats.framesSkipped << L" skipped, "
+                   << stats.facesFound << L" faces, " << meanMs << L" ms mean, " << fps << L" fps" << std::endl;
+        pipelines[i]->logStageStats();
+
+        DetectionRateController::Metrics rate;
+        if(pipelines[i]->getRateMetrics(rate)) {
+            std::wcout << L"  rate     " << rate.effectiveFps << L" fps, " << rate.detectMs << L" ms per frame, "
+                       << rate.budgetUsed * 100.0 << L"% of budget" << std::endl;
+        }
+        ScanQualityController::Metrics quality;
+        if(pipelines[i]->getQualityMetrics(quality)) {
+            std::wcout << L"  quality  rung " << quality.level << L" of " << quality.levelCount - 1
+                       << L", p95 " << quality.p95Ms << L" ms, " << quality.downgrades << L" down, "
+                       << quality.upgrades << L" up" << std::endl;
+        }
+    }
+    for(int slot : schedulerSlots) {
+        if(slot < 0) continue;
+        scheduler.logStats();
+        break;
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../classifier/haar_cascade.h"
+#include "../classifier/window_plan.h"
+#include "../source/frame_source.h"
+#include "deadline_scheduler.h"
+#include "pipeline.h"
+#include "thread_pool.h"
+
+/*
+** Several sources detected at once with one loaded cascade and one
+** pool. Each source gets a Pipeline of its own, so frame pools, window
+** plans, groupers and result channels are per source, while the cascade
+** is only read and every detection stage runs on the shared workers.
+** N cameras therefore cost one cascade and one set of worker threads,
+** not N of each.
+**
+** Every source is read by a thread of its own. Those threads spend
+** their time waiting on the device or the file; the detection work
+** itself only runs on the pool.
+**
+** Live sources are admitted through a DeadlineScheduler, so under
+** overload each keeps its share and stale frames are dropped rather
+** than detected late. Offline sources still process every frame.
+*/
+class MultiSourceRuntime {
+    public:
+        typedef std::function<void(size_t source, const PipelineResult& result)> ResultCallback;
+
+        // Applied to every source when run() starts
+        ScanConfig scanConfig;
+        bool useSquaredIntegral;
+
+        // Without a pool the shared one is used
+        MultiSourceRuntime(
+            const HaarCascade& cascade,
+            ThreadPool* pool = nullptr,
+            size_t queueDepth = 2
+        );
+        ~MultiSourceRuntime();
+
+        MultiSourceRuntime(const MultiSourceRuntime&) = delete;
+        MultiSourceRuntime& operator=(const MultiSourceRuntime&) = delete;
+
+        // The source is not owned and must outlive the runtime; returns its index
+        size_t addSource(
+            IFrameSource& source,
+            double targetFps = 15.0
+        );
+        // Live sources only
+        void setTargetRate(size_t index, double targetFps);
+        void setRateControl(size_t index, const DetectionRateController::Config& config);
+        void setQualityControl(size_t index, const ScanQualityController::Config& config);
+        size_t getSourceCount() const {
+            return pipelines.size();
+        }
+        Pipeline& getPipeline(size_t index) {
+            return *pipelines[index];
+        }
+
+        // Called on the pool, in order per source; sources interleave freely
+        void setResultCallback(ResultCallback callback);
+
+        // Blocks until every source has ended, stop() is called or each has maxFrames (0 = no limit)
+        bool run(uint64_t maxFramesPerSource = 0);
+        void stop();
+
+        Pipeline::Stats getStats(size_t index) const;
+        std::vector<Rect> getLatestFaces(size_t index) const;
+        void logStats() const;
+
+    private:
+        const HaarCascade& cascade;
+        ThreadPool& pool;
+        size_t queueDepth;
+        std::vector<IFrameSource*> sources;
+        std::vector<std::unique_ptr<Pipeline>> pipelines;
+        // Declared after the pipelines so it goes first and drains their stages
+        DeadlineScheduler scheduler;
+        // Scheduler slot per source, or -1 for offline sources
+        std::vector<int> schedulerSlots;
+        ResultCallback resultCallback;
+};
@@ -0,0 +1,224 @@
+#include "pipeline.h"
+#include "deadline_scheduler.h"
+#include <chrono>
+#include <iostream>
+
+Pipeline::Pipeline(
+    IFrameSource& source,
+    const HaarCascade& cascade,
+    ThreadPool* pool,
+    size_t queueDepth
+) :
+    useSquaredIntegral(false),
+    exclusionMask(nullptr),
+    scaleMap(nullptr),
+    source(source),
+    cascade(cascade),
+    stages(cascade, pool ? *pool : ThreadPool::shared(), queueDepth),
+    scheduler(nullptr),
+    schedulerIndex(0),
+    // Frames are let go after the integral stage; enough for both stages full plus the one being read
+    framePool(2 * (queueDepth + 2) + 1),
+    running(false),
+    sourceEnded(false),
+    framesRead(0),
+    framesSkipped(0),
+    droppedAtStart(0),
+    stats()
+{
+    stages.setResultCallback([this](const PipelineResult& result) {
+        onResult(result);
+    });
+}
+
+Pipeline::~Pipeline() {
+    stop();
+    if(captureThread.joinable()) captureThread.join();
+    stages.drain();
+}
+
+void Pipeline::setResultCallback(ResultCallback callback) {
+    resultCallback = callback;
+}
+
+void Pipeline::setScheduler(DeadlineScheduler* deadlineScheduler, size_t index) {
+    scheduler = deadlineScheduler;
+    schedulerIndex = index;
+}
+
+void Pipeline::setRateControl(const DetectionRateController::Config& config) {
+    rateController.reset(new DetectionRateController(config));
+}
+
+bool Pipeline::getRateMetrics(DetectionRateController::Metrics& metrics) const {
+    if(!rateController) return false;
+    metrics = rateController->getMetrics();
+    return true;
+}
+
+void Pipeline::setQualityControl(const ScanQualityController::Config& config) {
+    qualityController.reset(new ScanQualityController(config));
+    stages.qualityController = qualityController.get();
+}
+
+bool Pipeline::getQualityMetrics(ScanQualityController::Metrics& metrics) const {
+    if(!qualityController) return false;
+    metrics = qualityController->getMetrics();
+    return true;
+}
+
+void Pipeline::stop() {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        running = false;
+    }
+    resultCondition.notify_all();
+}
+
+/*
+** Run
+*/
+bool Pipeline::run(uint64_t maxFrames) {
+    if(!cascade.isLoaded()) {
+        std::wcout << L"Pipeline has no cascade loaded" << std::endl;
+        return false;
+    }
+    if(!source.open()) {
+        std::wcout << L"Failed to open source " << source.getName() << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats = Stats();
+    }
+    stages.scanConfig = scanConfig;
+    stages.useSquaredIntegral = useSquaredIntegral;
+    stages.exclusionMask = exclusionMask;
+    stages.scaleMap = scaleMap;
+    droppedAtStart = stages.getDropped() + scheduledDrops();
+    framesRead = 0;
+    framesSkipped = 0;
+    sourceEnded = false;
+    running = true;
+
+    auto start = std::chrono::steady_clock::now();
+    bool result = source.isLive() ? runLive(maxFrames) : runOffline(maxFrames);
+    running = false;
+    if(scheduler) scheduler->clear(schedulerIndex);
+    stages.drain();
+    source.close();
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.framesRead = framesRead.load();
+    stats.framesSkipped = framesSkipped.load();
+    stats.framesDropped = stages.getDropped() + scheduledDrops() - droppedAtStart;
+    stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool Pipeline::runOffline(uint64_t maxFrames) {
+    while(running && (maxFrames == 0 || framesRead < maxFrames)) {
+        FrameHandle frame = framePool.acquire();
+        if(!frame) {
+            // Every buffer is still being converted; the stages will hand one back
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if(!source.readFrame(frame.writable())) break;
+        frame.writable().sequence = framesRead++;
+        stages.submit(frame, true);
+    }
+    return true;
+}
+
+bool Pipeline::runLive(uint64_t maxFrames) {
+    captureThread = std::thread(&Pipeline::captureLoop, this);
+
+    {
+        std::unique_lock<std::mutex> lock(statsMutex);
+        resultCondition.wait(lock, [this, maxFrames]() {
+            return !running || sourceEnded || (maxFrames > 0 && stats.framesProcessed >= maxFrames);
+        });
+    }
+
+    running = false;
+    if(captureThread.joinable()) captureThread.join();
+    return true;
+}
+
+/*
+** Capture Loop
+*/
+void Pipeline::captureLoop() {
+    while(running) {
+        FrameHandle frame = framePool.acquire();
+        if(!frame) {
+            // Every buffer is still held downstream; let detection catch up
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        if(!source.readFrame(frame.writable())) break;
+        frame.writable().sequence = framesRead++;
+        if(rateController && !rateController->shouldDetect(frame.view())) {
+            framesSkipped++;
+            continue;
+        }
+        if(scheduler) {
+            scheduler->submit(schedulerIndex, frame);
+        } else {
+            stages.submit(frame, false);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        sourceEnded = true;
+    }
+    resultCondition.notify_all();
+}
+
+uint64_t Pipeline::scheduledDrops() const {
+    return scheduler ? scheduler->getStats(schedulerIndex).dropped : 0;
+}
+
+/*
+** Results
+*/
+void Pipeline::onResult(const PipelineResult& result) {
+    if(rateController) rateController->reportDetection(result.workMs, result.faces.size());
+    latestFaces.store(FaceSnapshot(result));
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.framesProcessed++;
+        stats.facesFound += result.faces.size();
+        stats.totalDetectMs += result.detectMs;
+        if(result.detectMs > stats.maxDetectMs) stats.maxDetectMs = result.detectMs;
+    }
+    resultCondition.notify_all();
+    if(resultCallback) resultCallback(result);
+}
+
+Pipeline::Stats Pipeline::getStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    Stats current = stats;
+    if(running) {
+        current.framesRead = framesRead.load();
+        current.framesSkipped = framesSkipped.load();
+        current.framesDropped = stages.getDropped() + scheduledDrops() - droppedAtStart;
+    }
+    return current;
+}
+
+std::vector<Pipeline::StageStats> Pipeline::getStageStats() const {
+    return stages.getStats();
+}
+
+void Pipeline::logStageStats() const {
+    stages.logStats();
+}
+
+std::vector<Rect> Pipeline::getLatestFaces() const {
+    FaceSnapshot snapshot;
+    latestFaces.load(snapshot);
+    return snapshot.toVector();
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../classifier/haar_cascade.h"
+#include "../classifier/exclusion_mask.h"
+#include "../classifier/scale_map.h"
+#include "../classifier/window_plan.h"
+#include "../source/frame_pool.h"
+#include "../source/frame_source.h"
+#include "detection_rate.h"
+#include "detection_stages.h"
+#include "result_channel.h"
+#include "scan_quality.h"
+#include "thread_pool.h"
+
+class DeadlineScheduler;
+
+/*
+** Capture -> convert -> detect -> publish with no window, renderer or
+** capture API in the loop, so it runs wherever the source does.
+**
+** Frames go through DetectionStages, so consecutive frames overlap:
+** one is integrated while the one before it is scanned. Live sources are
+** read on their own thread and submitted without waiting, so when
+** detection falls behind only the newest frame waits for it and the
+** rest are dropped, as in the windowed app. That reader blocks on the
+** device, so it is a plain thread rather than a task that would hold a
+** pool worker hostage.
+** Offline sources (files, synthetic) wait for room instead, so every
+** frame is processed and runs are reproducible.
+**
+** With a DeadlineScheduler, live frames go through it instead of
+** straight into the stages, so several sources share detection fairly.
+*/
+class Pipeline {
+    public:
+        typedef std::function<void(const PipelineResult&)> ResultCallback;
+        typedef DetectionStages::StageStats StageStats;
+
+        struct Stats {
+            uint64_t framesRead;
+            uint64_t framesProcessed;
+            uint64_t framesDropped;
+            // Passed over by the rate controller
+            uint64_t framesSkipped;
+            uint64_t facesFound;
+            // Submit to publish, per frame
+            double totalDetectMs;
+            double maxDetectMs;
+            double elapsedSeconds;
+        };
+
+        ScanConfig scanConfig;
+        bool useSquaredIntegral;
+        const ExclusionMask* exclusionMask;
+        const ScaleMap* scaleMap;
+
+        // Without a pool the shared one is used
+        Pipeline(
+            IFrameSource& source,
+            const HaarCascade& cascade,
+            ThreadPool* pool = nullptr,
+            size_t queueDepth = 2
+        );
+        ~Pipeline();
+
+        void setResultCallback(ResultCallback callback);
+        // Live frames are submitted as `index` of the scheduler, which must be set up for these stages
+        void setScheduler(DeadlineScheduler* scheduler, size_t index);
+        DetectionStages& getStages() {
+            return stages;
+        }
+        // Live sources only: detect as often as the budget allows instead of every frame
+        void setRateControl(const DetectionRateController::Config& config);
+        bool getRateMetrics(DetectionRateController::Metrics& metrics) const;
+        // Coarsen the scan when frames take longer than the target
+        void setQualityControl(const ScanQualityController::Config& config);
+        bool getQualityMetrics(ScanQualityController::Metrics& metrics) const;
+
+        // Blocks until the source ends, stop() is called or maxFrames are detected (0 = no limit)
+        bool run(uint64_t maxFrames = 0);
+        void stop();
+
+        Stats getStats() const;
+        std::vector<StageStats> getStageStats() const;
+        void logStageStats() const;
+        std::vector<Rect> getLatestFaces() const;
+        // Readers never wait on the publish stage; the version moves on with every result
+        const FaceChannel& getResults() const {
+            return latestFaces;
+        }
+
+    private:
+        IFrameSource& source;
+        const HaarCascade& cascade;
+        DetectionStages stages;
+        ResultCallback resultCallback;
+        DeadlineScheduler* scheduler;
+        size_t schedulerIndex;
+        std::unique_ptr<DetectionRateController> rateController;
+        std::unique_ptr<ScanQualityController> qualityController;
+
+        FramePool framePool;
+        std::thread captureThread;
+        std::atomic<bool> running;
+        std::atomic<bool> sourceEnded;
+        std::atomic<uint64_t> framesRead;
+        std::atomic<uint64_t> framesSkipped;
+        uint64_t droppedAtStart;
+
+        mutable std::mutex statsMutex;
+        std::condition_variable resultCondition;
+        Stats stats;
+        FaceChannel latestFaces;
+
+        bool runOffline(uint64_t maxFrames);
+        bool runLive(uint64_t maxFrames);
+        void captureLoop();
+        void onResult(const PipelineResult& result);
+        uint64_t scheduledDrops() const;
+};
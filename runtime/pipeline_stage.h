@@ -0,0 +1,201 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include "thread_pool.h"
+
+/*
+** One step of a staged pipeline: a bounded input queue and a piece of
+** work run on the pool. At most one task per stage is queued or running,
+** so a stage sees its items in order and keeps no locks around the work
+** itself. When the next stage is full the finished item is held back
+** and the stage stops taking input; room opening up downstream wakes it
+** again, so a slow stage throttles everything upstream of it.
+*/
+template<typename Item>
+class PipelineStage {
+    public:
+        typedef std::function<void(Item&)> Work;
+        typedef std::function<void(Item*)> Sink;
+
+        struct Stats {
+            const wchar_t* name;
+            size_t depth;
+            size_t maxDepth;
+            size_t capacity;
+            uint64_t processed;
+            // Items that finished while the next stage was full
+            uint64_t blocked;
+            double totalServiceMs;
+            double maxServiceMs;
+
+            double meanServiceMs() const {
+                return processed ? totalServiceMs / processed : 0.0;
+            }
+        };
+
+        PipelineStage(
+            const wchar_t* name,
+            size_t capacity,
+            TaskGroup& tasks,
+            Work work
+        ) :
+            tasks(tasks),
+            work(work),
+            next(nullptr),
+            previous(nullptr),
+            held(nullptr),
+            running(false),
+            poked(false),
+            stats()
+        {
+            stats.name = name;
+            stats.capacity = capacity;
+        }
+
+        // Items leaving the last stage go to the sink
+        void connect(PipelineStage* nextStage) {
+            next = nextStage;
+            if(next) next->previous = this;
+        }
+        void setSink(Sink finished) {
+            sink = finished;
+        }
+
+        bool tryPush(Item* item) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(queue.size() >= stats.capacity) return false;
+                enqueue(item);
+            }
+            schedule();
+            return true;
+        }
+
+        // Blocks until there is room
+        void pushWait(Item* item) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                spaceCondition.wait(lock, [this]() {
+                    return queue.size() < stats.capacity;
+                });
+                enqueue(item);
+            }
+            schedule();
+        }
+
+        bool hasRoom() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return queue.size() < stats.capacity;
+        }
+        bool idle() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return queue.empty() && !running && !held;
+        }
+        Stats getStats() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            Stats current = stats;
+            current.depth = queue.size();
+            return current;
+        }
+
+    private:
+        TaskGroup& tasks;
+        Work work;
+        Sink sink;
+        PipelineStage* next;
+        PipelineStage* previous;
+        std::deque<Item*> queue;
+        // Only touched by the stage's own task
+        Item* held;
+        bool running;
+        // Set when the stage was woken while its task was still running
+        bool poked;
+        mutable std::mutex mutex;
+        std::condition_variable spaceCondition;
+        Stats stats;
+
+        void enqueue(Item* item) {
+            queue.push_back(item);
+            if(queue.size() > stats.maxDepth) stats.maxDepth = queue.size();
+        }
+
+        void schedule() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(running) {
+                    poked = true;
+                    return;
+                }
+                running = true;
+            }
+            tasks.run([this]() {
+                step();
+            });
+        }
+
+        void step() {
+            if(held) {
+                if(!next->tryPush(held)) {
+                    retire();
+                    return;
+                }
+                held = nullptr;
+            }
+
+            Item* item = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if(!queue.empty()) {
+                    item = queue.front();
+                    queue.pop_front();
+                }
+            }
+            if(item) {
+                spaceCondition.notify_all();
+                if(previous) previous->schedule();
+
+                auto start = std::chrono::steady_clock::now();
+                work(*item);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                bool forwarded = !next || next->tryPush(item);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stats.processed++;
+                    stats.totalServiceMs += ms;
+                    if(ms > stats.maxServiceMs) stats.maxServiceMs = ms;
+                    if(!forwarded) stats.blocked++;
+                }
+                if(!forwarded) {
+                    held = item;
+                } else if(!next && sink) {
+                    sink(item);
+                }
+            }
+            retire();
+        }
+
+        /*
+        ** Go idle, unless there is more to do or something woke the
+        ** stage while it ran; then queue the next step right away.
+        */
+        void retire() {
+            bool room = held && next->hasRoom();
+            bool again;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                again = poked || (held ? room : !queue.empty());
+                poked = false;
+                if(!again) running = false;
+            }
+            if(again) {
+                tasks.run([this]() {
+                    step();
+                });
+            }
+        }
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "../classifier/rect.h"
+#include "detection_stages.h"
+
+/*
+** The latest value from one writer to any number of readers, behind a
+** seqlock. The writer never waits. A reader copies the value out and
+** starts over if a write went by meanwhile, so it only ever spins
+** behind a copy in progress, never behind the detector. The value is
+** kept as atomic words so the racing copy is well defined, which is
+** why it has to be trivially copyable.
+**
+** The version counts writes: 0 before the first, one up per store. A
+** reader that keeps the last version it saw can tell a new value
+** without copying anything.
+*/
+template<typename T>
+class ResultChannel {
+    static_assert(std::is_trivially_copyable<T>::value, "ResultChannel needs a trivially copyable type");
+
+    public:
+        ResultChannel() :
+            sequence(0)
+        {
+            for(auto& word : words) word.store(0, std::memory_order_relaxed);
+        }
+
+        // One writer at a time
+        void store(const T& value) {
+            Word buffer[WORDS] = {};
+            std::memcpy(buffer, &value, sizeof(T));
+
+            uint64_t current = sequence.load(std::memory_order_relaxed);
+            sequence.store(current + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for(size_t i = 0; i < WORDS; i++) words[i].store(buffer[i], std::memory_order_relaxed);
+            sequence.store(current + 2, std::memory_order_release);
+        }
+
+        uint64_t version() const {
+            return sequence.load(std::memory_order_acquire) / 2;
+        }
+
+        // Copies out the latest value and returns its version
+        uint64_t load(T& value) const {
+            Word buffer[WORDS];
+            for(;;) {
+                uint64_t before = sequence.load(std::memory_order_acquire);
+                if(before & 1) continue;
+                for(size_t i = 0; i < WORDS; i++) buffer[i] = words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(sequence.load(std::memory_order_relaxed) != before) continue;
+
+                std::memcpy(&value, buffer, sizeof(T));
+                return before / 2;
+            }
+        }
+
+        // Copies out only when there is something newer than `seen`, and moves `seen` up
+        bool loadIfNewer(uint64_t& seen, T& value) const {
+            if(version() == seen) return false;
+            seen = load(value);
+            return true;
+        }
+
+    private:
+        typedef uint64_t Word;
+        static const size_t WORDS = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+        std::atomic<uint64_t> sequence;
+        std::atomic<Word> words[WORDS];
+};
+
+/*
+** One published detection, flat so it fits through a ResultChannel.
+** A frame with more than MAX_FACES faces is cut off at MAX_FACES.
+*/
+struct FaceSnapshot {
+    static const size_t MAX_FACES = 32;
+
+    uint64_t sequence;
+    int64_t timestamp;
+    int width;
+    int height;
+    uint32_t count;
+    Rect faces[MAX_FACES];
+
+    FaceSnapshot() :
+        sequence(0),
+        timestamp(0),
+        width(0),
+        height(0),
+        count(0) {}
+
+    explicit FaceSnapshot(const PipelineResult& result) :
+        sequence(result.sequence),
+        timestamp(result.timestamp),
+        width(result.width),
+        height(result.height),
+        count(static_cast<uint32_t>(result.faces.size() < MAX_FACES ? result.faces.size() : MAX_FACES))
+    {
+        for(uint32_t i = 0; i < count; i++) faces[i] = result.faces[i];
+    }
+
+    std::vector<Rect> toVector() const {
+        return std::vector<Rect>(faces, faces + count);
+    }
+};
+
+typedef ResultChannel<FaceSnapshot> FaceChannel;
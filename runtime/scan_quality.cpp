@@ -0,0 +1,136 @@
+#include "scan_quality.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    const int MAX_CALM_WINDOWS = 64;
+}
+
+ScanQualityController::ScanQualityController(
+    const Config& config,
+    const std::vector<Level>& ladder
+) :
+    config(config),
+    ladder(ladder),
+    level(0),
+    calmWindows(0),
+    calmNeeded(config.upgradeAfter),
+    justUpgraded(false),
+    p95Ms(0.0),
+    overTarget(false),
+    downgrades(0),
+    upgrades(0)
+{
+    if(this->ladder.empty()) this->ladder = defaultLadder();
+    if(this->config.window == 0) this->config.window = 1;
+    samples.reserve(this->config.window);
+}
+
+/*
+** Ladder
+**
+** Rung 0 is the detector's own defaults. Scale factor and stride go
+** first, they thin out windows at every size; dropping the smallest
+** faces and decimating lose the most, so they come last.
+*/
+std::vector<ScanQualityController::Level> ScanQualityController::defaultLadder() {
+    return {
+        { 1.25f, 3, 24, 1 },
+        { 1.35f, 3, 24, 1 },
+        { 1.35f, 4, 24, 1 },
+        { 1.35f, 4, 32, 1 },
+        { 1.35f, 4, 32, 2 },
+        { 1.5f, 5, 40, 2 },
+        { 1.5f, 6, 48, 4 }
+    };
+}
+
+ScanConfig ScanQualityController::configFor(const ScanConfig& base, size_t* appliedRung) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(appliedRung) *appliedRung = level;
+    const Level& rung = ladder[level];
+    ScanConfig result = base;
+    result.scaleFactor = (std::max)(base.scaleFactor, rung.scaleFactor);
+    result.step = (std::max)(base.step, rung.step);
+    result.minSize = (std::min)((std::max)(base.minSize, rung.minSize), base.maxSize);
+    result.decimation = (std::max)(base.decimation, rung.decimation);
+    return result;
+}
+
+/*
+** Report
+*/
+void ScanQualityController::report(double detectMs, size_t rung) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if(rung != level) return;
+    samples.push_back(detectMs);
+    if(samples.size() < config.window) return;
+
+    size_t rank = (samples.size() * 95 + 99) / 100 - 1;
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    double p95 = samples[rank];
+    samples.clear();
+    p95Ms = p95;
+    overTarget = p95 > config.targetP95Ms;
+
+    if(overTarget) {
+        calmWindows = 0;
+        if(justUpgraded) calmNeeded = (std::min)(calmNeeded * 2, MAX_CALM_WINDOWS);
+        if(level + 1 < ladder.size()) move(level + 1, p95);
+        return;
+    }
+    if(justUpgraded) {
+        // The step up held
+        justUpgraded = false;
+        calmNeeded = config.upgradeAfter;
+    }
+    if(p95 < config.targetP95Ms * config.headroom) {
+        if(++calmWindows >= calmNeeded && level > 0) move(level - 1, p95);
+    } else {
+        calmWindows = 0;
+    }
+}
+
+void ScanQualityController::move(size_t to, double p95) {
+    if(to > level) {
+        downgrades++;
+    } else {
+        upgrades++;
+    }
+    std::wcout << L"Scan quality " << level << L" -> " << to << L" of " << ladder.size() - 1
+               << L", p95 " << p95 << L" ms against " << config.targetP95Ms << L" ms" << std::endl;
+    justUpgraded = to < level;
+    level = to;
+    calmWindows = 0;
+    samples.clear();
+}
+
+void ScanQualityController::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    level = 0;
+    samples.clear();
+    calmWindows = 0;
+    calmNeeded = config.upgradeAfter;
+    justUpgraded = false;
+    p95Ms = 0.0;
+    overTarget = false;
+}
+
+ScanQualityController::Metrics ScanQualityController::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Metrics metrics;
+    metrics.level = level;
+    metrics.levelCount = ladder.size();
+    metrics.p95Ms = p95Ms;
+    metrics.overTarget = overTarget;
+    metrics.downgrades = downgrades;
+    metrics.upgrades = upgrades;
+    return metrics;
+}
+
+void ScanQualityController::logMetrics() const {
+    Metrics metrics = getMetrics();
+    std::wcout << L"Scan quality: rung " << metrics.level << L" of " << metrics.levelCount - 1
+               << L", p95 " << metrics.p95Ms << L" ms, " << metrics.downgrades << L" down, "
+               << metrics.upgrades << L" up" << std::endl;
+}
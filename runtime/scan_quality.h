@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "../classifier/window_plan.h"
+
+/*
+** Trades scan quality for time when detection runs over its latency
+** target. The controller walks a ladder of ever cheaper scan settings:
+** coarser scale steps, a larger window stride, a larger smallest face,
+** then a decimated image. Each rung sets lower bounds, so a setting
+** already coarser than the rung is left alone.
+**
+** Work times are collected in windows of `window` frames. A window
+** whose p95 is over the target moves one rung down at once; stepping
+** back up needs `upgradeAfter` windows in a row with p95 below
+** target * headroom. Samples from the previous rung, including frames
+** still in flight when it moved, are thrown away, so one slow burst
+** costs a single step. A step up that is undone by its very first
+** window doubles the calm windows needed before the next try, so a
+** load sitting between two rungs does not flap between them.
+*/
+class ScanQualityController {
+    public:
+        struct Level {
+            float scaleFactor;
+            int step;
+            int minSize;
+            int decimation;
+        };
+
+        struct Config {
+            double targetP95Ms;
+            size_t window;
+            double headroom;
+            int upgradeAfter;
+
+            Config(
+                double targetP95Ms = 50.0,
+                size_t window = 30,
+                double headroom = 0.6,
+                int upgradeAfter = 3
+            ) :
+            targetP95Ms(targetP95Ms),
+            window(window),
+            headroom(headroom),
+            upgradeAfter(upgradeAfter) {}
+        };
+
+        struct Metrics {
+            size_t level;
+            size_t levelCount;
+            // Of the last full window
+            double p95Ms;
+            // That window was over target; at the last rung nothing is left to give
+            bool overTarget;
+            uint64_t downgrades;
+            uint64_t upgrades;
+        };
+
+        explicit ScanQualityController(
+            const Config& config = Config(),
+            const std::vector<Level>& ladder = defaultLadder()
+        );
+
+        static std::vector<Level> defaultLadder();
+
+        // The base config with the current rung applied, and which rung that was
+        ScanConfig configFor(const ScanConfig& base, size_t* appliedRung = nullptr) const;
+        // Times from frames scanned under an older rung are ignored
+        void report(double detectMs, size_t rung);
+        void reset();
+
+        Metrics getMetrics() const;
+        void logMetrics() const;
+
+    private:
+        Config config;
+        std::vector<Level> ladder;
+        mutable std::mutex mutex;
+
+        size_t level;
+        std::vector<double> samples;
+        int calmWindows;
+        int calmNeeded;
+        bool justUpgraded;
+        double p95Ms;
+        bool overTarget;
+        uint64_t downgrades;
+        uint64_t upgrades;
+
+        void move(size_t to, double p95);
+};
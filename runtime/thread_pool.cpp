@@ -0,0 +1,271 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+namespace {
+    // Which pool, and which of its queues, the current thread works for
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentIndex = 0;
+
+    std::mutex sharedMutex;
+    size_t sharedThreadCount = 0;
+    bool sharedConfigured = false;
+    bool sharedCreated = false;
+
+    size_t sharedThreads() {
+        std::lock_guard<std::mutex> lock(sharedMutex);
+        sharedCreated = true;
+        if(sharedConfigured) return sharedThreadCount;
+
+        const char* env = std::getenv("CAMVALLEY_THREADS");
+        if(env && *env) {
+            char* end = nullptr;
+            unsigned long count = std::strtoul(env, &end, 10);
+            if(end && *end == '\0' && count > 0) return static_cast<size_t>(count);
+            std::wcout << L"Ignoring invalid CAMVALLEY_THREADS value: " << env << std::endl;
+        }
+        return 0;
+    }
+}
+
+ThreadPool::ThreadPool(size_t threadCount) :
+    pending(0),
+    stopping(false)
+{
+    if(threadCount == 0) {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 0 ? hardware : 1;
+    }
+    size_t workerCount = threadCount - 1;
+    for(size_t i = 0; i <= workerCount; i++) {
+        queues.emplace_back(new Queue());
+    }
+    for(size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for(auto& worker : workers) {
+        if(worker.joinable()) worker.join();
+    }
+}
+
+/*
+** Shared Pool
+*/
+bool ThreadPool::configureShared(size_t threadCount) {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if(sharedCreated) {
+        std::wcout << L"Shared thread pool already running, ignoring thread count " << threadCount << std::endl;
+        return false;
+    }
+    sharedThreadCount = threadCount;
+    sharedConfigured = true;
+    return true;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static std::unique_ptr<ThreadPool> pool = []() {
+        std::unique_ptr<ThreadPool> created(new ThreadPool(sharedThreads()));
+        std::wcout << L"Shared thread pool: " << created->size() << L" threads" << std::endl;
+        return created;
+    }();
+    return *pool;
+}
+
+/*
+** Submit
+*/
+void ThreadPool::submit(std::function<void()> task) {
+    if(workers.empty()) {
+        task();
+        return;
+    }
+
+    Queue& queue = *queues[localQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
+
+bool ThreadPool::onWorker() const {
+    return currentPool == this;
+}
+
+size_t ThreadPool::localQueue() const {
+    return onWorker() ? currentIndex : queues.size() - 1;
+}
+
+/*
+** Own queue newest-first, then the inbox, then steal oldest-first
+*/
+bool ThreadPool::popTask(size_t self, std::function<void()>& task) {
+    size_t inbox = queues.size() - 1;
+    if(self != inbox) {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    for(size_t i = 0; i < queues.size(); i++) {
+        size_t victim = (inbox + i) % queues.size();
+        if(victim == self && self != inbox) continue;
+        Queue& queue = *queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    for(;;) {
+        std::function<void()> task;
+        if(popTask(index, task)) {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() {
+            return stopping || pending.load() > 0;
+        });
+        if(stopping && pending.load() == 0) return;
+    }
+}
+
+/*
+** Parallel For
+*/
+void ThreadPool::parallelFor(
+    size_t count,
+    const std::function<void(size_t)>& body
+) {
+    if(count == 0) return;
+    if(count == 1 || workers.empty()) {
+        for(size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto drain = [&]() {
+        for(size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) body(i);
+    };
+
+    TaskGroup group(*this);
+    size_t helpers = (std::min)(workers.size(), count - 1);
+    for(size_t i = 0; i < helpers; i++) group.run(drain);
+    drain();
+    group.wait();
+}
+
+void ThreadPool::parallelFor(
+    size_t begin,
+    size_t end,
+    size_t grain,
+    const std::function<void(size_t, size_t)>& body
+) {
+    if(end <= begin) return;
+    grain = (std::max)(grain, static_cast<size_t>(1));
+    size_t chunks = (end - begin + grain - 1) / grain;
+    parallelFor(chunks, [&](size_t chunk) {
+        size_t first = begin + chunk * grain;
+        body(first, (std::min)(end, first + grain));
+    });
+}
+
+/*
+** Task Group
+*/
+TaskGroup::TaskGroup(ThreadPool& pool) :
+    pool(pool),
+    outstanding(0) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    std::shared_ptr<Job> job = std::make_shared<Job>(std::move(task));
+    outstanding.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        while(!unstarted.empty() && unstarted.front()->claimed.load()) unstarted.pop_front();
+        unstarted.push_back(job);
+    }
+    // Wakes a worker waiting on the group, which may run the job itself
+    doneCondition.notify_all();
+
+    // The wrapper may outlive the group, so it only touches the group after claiming the job
+    pool.submit([this, job]() {
+        if(job->claimed.exchange(true)) return;
+        execute(*job);
+    });
+}
+
+std::shared_ptr<TaskGroup::Job> TaskGroup::claimUnstarted() {
+    while(!unstarted.empty()) {
+        std::shared_ptr<Job> job = unstarted.back();
+        unstarted.pop_back();
+        if(!job->claimed.exchange(true)) return job;
+    }
+    return nullptr;
+}
+
+void TaskGroup::execute(Job& job) {
+    try {
+        job.task();
+    } catch(const std::exception& err) {
+        std::wcout << L"Exception in pool task: " << err.what() << std::endl;
+    }
+    job.task = nullptr;
+    // Decrement under the lock so wait() cannot return, and the group go away, before the notify
+    std::lock_guard<std::mutex> lock(doneMutex);
+    if(outstanding.fetch_sub(1) == 1) doneCondition.notify_all();
+}
+
+void TaskGroup::wait() {
+    bool helping = pool.onWorker();
+    std::unique_lock<std::mutex> lock(doneMutex);
+    for(;;) {
+        if(helping) {
+            std::shared_ptr<Job> job = claimUnstarted();
+            if(job) {
+                lock.unlock();
+                execute(*job);
+                lock.lock();
+                continue;
+            }
+        }
+        if(outstanding.load() == 0) return;
+        doneCondition.wait(lock, [this, helping]() {
+            return outstanding.load() == 0 || (helping && !unstarted.empty());
+        });
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+** Work-stealing pool. Every worker owns a deque: it pushes and pops its
+** own tasks at the back, so nested work stays hot in its cache, and an
+** idle worker steals from the front of the others. Tasks submitted from
+** outside the pool go to a shared inbox that every worker drains.
+**
+** A worker blocked in TaskGroup::wait or parallelFor runs the tasks of
+** that group nobody has started yet, so a task may fork and join more
+** work without tying up the thread it runs on. Threads outside the pool
+** just block; they never pick up unrelated work.
+*/
+class ThreadPool {
+    public:
+        // 0 means one thread per hardware thread; the count includes the caller
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /*
+        ** The process-wide pool, created on first use. Call
+        ** configureShared() at startup to pick the thread count;
+        ** otherwise CAMVALLEY_THREADS, then the hardware count, is used.
+        */
+        static bool configureShared(size_t threadCount);
+        static ThreadPool& shared();
+
+        size_t size() const {
+            return workers.size() + 1;
+        }
+
+        void submit(std::function<void()> task);
+
+        // True on one of this pool's own worker threads
+        bool onWorker() const;
+
+        void parallelFor(
+            size_t count,
+            const std::function<void(size_t)>& body
+        );
+        // body(begin, end) over chunks of at least `grain` indices
+        void parallelFor(
+            size_t begin,
+            size_t end,
+            size_t grain,
+            const std::function<void(size_t, size_t)>& body
+        );
+
+    private:
+        struct Queue {
+            std::deque<std::function<void()>> tasks;
+            std::mutex mutex;
+        };
+
+        std::vector<std::thread> workers;
+        // One per worker, plus the inbox for outside threads at the end
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::atomic<size_t> pending;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        bool stopping;
+
+        size_t localQueue() const;
+        bool popTask(size_t self, std::function<void()>& task);
+        void workerLoop(size_t index);
+};
+
+/*
+** Tasks that are waited on together. wait() returns once every task
+** run() through the group has finished. Called on a pool worker, it
+** first runs the group's own tasks that are still queued.
+*/
+class TaskGroup {
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void run(std::function<void()> task);
+        void wait();
+
+        bool idle() const {
+            return outstanding.load() == 0;
+        }
+
+    private:
+        // Run by whoever claims it first: a pool thread or a waiting worker
+        struct Job {
+            std::function<void()> task;
+            std::atomic<bool> claimed;
+
+            Job(std::function<void()> task) :
+                task(std::move(task)),
+                claimed(false) {}
+        };
+
+        ThreadPool& pool;
+        std::atomic<size_t> outstanding;
+        // Jobs not known to be started, oldest first; guarded by doneMutex
+        std::deque<std::shared_ptr<Job>> unstarted;
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+
+        std::shared_ptr<Job> claimUnstarted();
+        void execute(Job& job);
+};
@@ -0,0 +1,204 @@
+#include "file_frame_source.h"
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+FileFrameSource::FileFrameSource(const std::string& fileName, bool loop) :
+    fileName(fileName),
+    isY4M(true),
+    loop(loop),
+    firstFrame(0),
+    planarChroma(false),
+    framesRead(0) {}
+
+FileFrameSource::FileFrameSource(
+    const std::string& fileName,
+    const FrameFormat& rawFormat,
+    bool loop
+) :
+    fileName(fileName),
+    isY4M(false),
+    loop(loop),
+    format(std::make_shared<FrameFormat>(rawFormat)),
+    firstFrame(0),
+    planarChroma(false),
+    framesRead(0) {}
+
+std::wstring FileFrameSource::getName() const {
+    return std::wstring(fileName.begin(), fileName.end());
+}
+
+bool FileFrameSource::open() {
+    close();
+    file.open(fileName, std::ios::binary);
+    if(!file.is_open()) {
+        std::wcout << L"Failed to open frame file: " << getName() << std::endl;
+        return false;
+    }
+
+    if(isY4M) {
+        if(!readHeader()) {
+            close();
+            return false;
+        }
+    } else if(!format || !format->valid()) {
+        std::wcout << L"Raw frame file needs a valid format: " << getName() << std::endl;
+        close();
+        return false;
+    }
+    firstFrame = file.tellg();
+    framesRead = 0;
+
+    std::wcout << L"Opened " << getName() << L": "
+               << format->width << L"x" << format->height << L" "
+               << pixelFormatName(format->pixelFormat) << L" @ " << format->fps() << L" fps" << std::endl;
+    return true;
+}
+
+void FileFrameSource::close() {
+    if(file.is_open()) file.close();
+    file.clear();
+}
+
+/*
+** Y4M Header
+*/
+bool FileFrameSource::readHeader() {
+    std::string line;
+    if(!std::getline(file, line) || line.compare(0, 10, "YUV4MPEG2 ") != 0) {
+        std::wcout << L"Not a YUV4MPEG2 file: " << getName() << std::endl;
+        return false;
+    }
+
+    auto parsed = std::make_shared<FrameFormat>();
+    parsed->fpsNumerator = 30;
+    parsed->fpsDenominator = 1;
+    std::string colorSpace = "420jpeg";
+
+    std::istringstream tokens(line.substr(10));
+    std::string token;
+    while(tokens >> token) {
+        std::string value = token.substr(1);
+        switch(token[0]) {
+            case 'W':
+                parsed->width = std::atoi(value.c_str());
+                break;
+            case 'H':
+                parsed->height = std::atoi(value.c_str());
+                break;
+            case 'F': {
+                size_t colon = value.find(':');
+                if(colon != std::string::npos) {
+                    parsed->fpsNumerator = std::atoi(value.substr(0, colon).c_str());
+                    parsed->fpsDenominator = std::atoi(value.substr(colon + 1).c_str());
+                }
+                break;
+            }
+            case 'C':
+                colorSpace = value;
+                break;
+            case 'I':
+                if(value != "p" && value != "?") {
+                    std::wcout << L"Interlaced Y4M is not supported" << std::endl;
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(colorSpace.compare(0, 3, "420") == 0) {
+        parsed->pixelFormat = PixelFormat::NV12;
+        planarChroma = true;
+    } else if(colorSpace == "mono") {
+        parsed->pixelFormat = PixelFormat::Gray8;
+        planarChroma = false;
+    } else {
+        std::wcout << L"Unsupported Y4M colour space: C"
+                   << std::wstring(colorSpace.begin(), colorSpace.end()) << std::endl;
+        return false;
+    }
+    // Interleaved chroma of an odd width needs one more byte per row than luma
+    parsed->stride = planarChroma ? (parsed->width + 1) & ~1 : parsed->width;
+    if(!parsed->valid()) {
+        std::wcout << L"Y4M header has no frame size" << std::endl;
+        return false;
+    }
+    format = parsed;
+    return true;
+}
+
+bool FileFrameSource::readFrameHeader() {
+    std::string line;
+    if(!std::getline(file, line)) return false;
+    if(line.compare(0, 5, "FRAME") != 0) {
+        std::wcout << L"Bad Y4M frame marker after frame " << framesRead << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+** Read Frame
+*/
+bool FileFrameSource::readFrame(Frame& frame) {
+    if(!file.is_open() || !format) return false;
+
+    for(int attempt = 0; attempt < 2; attempt++) {
+        if(file.peek() != std::char_traits<char>::eof()) {
+            if(isY4M && !readFrameHeader()) return false;
+            return readPayload(frame);
+        }
+        if(!loop || framesRead == 0) return false;
+        file.clear();
+        file.seekg(firstFrame);
+    }
+    return false;
+}
+
+bool FileFrameSource::readPayload(Frame& frame) {
+    int64_t timestamp = 0;
+    if(format->fpsNumerator > 0) {
+        timestamp = static_cast<int64_t>(framesRead) * 10000000 * format->fpsDenominator / format->fpsNumerator;
+    }
+    frame.reset(format, timestamp);
+
+    if(!planarChroma) {
+        std::streamsize size = static_cast<std::streamsize>(format->bufferSize());
+        if(!file.read(reinterpret_cast<char*>(frame.data.data()), size)) {
+            std::wcout << L"Truncated frame " << framesRead << L" in " << getName() << std::endl;
+            return false;
+        }
+        framesRead++;
+        return true;
+    }
+
+    // I420: a full Y plane, then quarter-size U and V planes
+    int chromaWidth = (format->width + 1) / 2;
+    int chromaHeight = (format->height + 1) / 2;
+    size_t planeSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+    chroma.resize(planeSize * 2);
+    bool complete = true;
+    for(int y = 0; y < format->height && complete; y++) {
+        complete = static_cast<bool>(file.read(reinterpret_cast<char*>(frame.row(y)), format->width));
+    }
+    if(complete) complete = static_cast<bool>(file.read(reinterpret_cast<char*>(chroma.data()), chroma.size()));
+    if(!complete) {
+        std::wcout << L"Truncated frame " << framesRead << L" in " << getName() << std::endl;
+        return false;
+    }
+
+    uint8_t* uv = frame.data.data() + format->stride * format->height;
+    const uint8_t* u = chroma.data();
+    const uint8_t* v = chroma.data() + planeSize;
+    for(int y = 0; y < chromaHeight; y++) {
+        uint8_t* out = uv + y * format->stride;
+        for(int x = 0; x < chromaWidth; x++) {
+            out[x * 2] = u[y * chromaWidth + x];
+            out[x * 2 + 1] = v[y * chromaWidth + x];
+        }
+    }
+    framesRead++;
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "frame_source.h"
+
+/*
+** Frames read back from disk, for reproducible runs without a camera.
+** Y4M files describe themselves; 4:2:0 streams are handed out as NV12
+** and mono streams as Gray8. Raw files are bare frames back to back in
+** the format given by the caller. Timestamps come from the frame index
+** and the file's frame rate, never from the wall clock.
+*/
+class FileFrameSource : public IFrameSource {
+    public:
+        // Y4M
+        explicit FileFrameSource(const std::string& fileName, bool loop = false);
+        // Raw frames of a known format
+        FileFrameSource(
+            const std::string& fileName,
+            const FrameFormat& rawFormat,
+            bool loop = false
+        );
+
+        std::wstring getName() const override;
+        bool isLive() const override {
+            return false;
+        }
+
+        bool open() override;
+        void close() override;
+        bool readFrame(Frame& frame) override;
+        std::shared_ptr<const FrameFormat> getFormat() const override {
+            return format;
+        }
+
+        uint64_t getFramesRead() const {
+            return framesRead;
+        }
+
+    private:
+        std::string fileName;
+        bool isY4M;
+        bool loop;
+        std::ifstream file;
+        std::shared_ptr<const FrameFormat> format;
+        std::streampos firstFrame;
+        // Planar Y4M chroma is interleaved into NV12 through this buffer
+        bool planarChroma;
+        std::vector<uint8_t> chroma;
+        uint64_t framesRead;
+
+        bool readHeader();
+        bool readFrameHeader();
+        bool readPayload(Frame& frame);
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "frame_format.h"
+
+/*
+** Non-owning strided view of one 8-bit plane.
+*/
+struct PlaneView {
+    const uint8_t* data;
+    int width;
+    int height;
+    size_t stride;
+
+    PlaneView() :
+        data(nullptr),
+        width(0),
+        height(0),
+        stride(0) {}
+    PlaneView(
+        const uint8_t* data,
+        int width,
+        int height,
+        size_t stride
+    ) :
+        data(data),
+        width(width),
+        height(height),
+        stride(stride) {}
+
+    bool empty() const {
+        return !data || width <= 0 || height <= 0;
+    }
+    const uint8_t* row(int y) const {
+        return data + y * stride;
+    }
+};
+
+/*
+** Non-owning view of a whole frame. Stages read through views; only the
+** owner of the Frame decides when the bytes go away.
+*/
+struct FrameView {
+    PixelFormat format;
+    int width;
+    int height;
+    size_t stride;
+    // Presentation time in 100 ns units, as reported by the source
+    int64_t timestamp;
+    // Position in the stream as counted by the producer, gaps mean drops
+    uint64_t sequence;
+    const uint8_t* data;
+    // Negotiated format of the stream, null for frames not from a source
+    const FrameFormat* streamFormat;
+
+    FrameView() :
+        format(PixelFormat::Unknown),
+        width(0),
+        height(0),
+        stride(0),
+        timestamp(0),
+        sequence(0),
+        data(nullptr),
+        streamFormat(nullptr) {}
+
+    bool empty() const {
+        return !data || width <= 0 || height <= 0;
+    }
+    const uint8_t* row(int y) const {
+        return data + y * stride;
+    }
+
+    /*
+    ** The grayscale plane, read in place, for formats that carry one
+    ** (Gray8 and NV12). Empty for packed formats.
+    */
+    PlaneView lumaPlane() const {
+        if(format != PixelFormat::Gray8 && format != PixelFormat::NV12) return PlaneView();
+        return PlaneView(data, width, height, stride);
+    }
+    PlaneView chromaPlane() const {
+        if(format != PixelFormat::NV12) return PlaneView();
+        return PlaneView(data + stride * height, width, (height + 1) / 2, stride);
+    }
+};
+
+/*
+** One frame in its native format, owning a single contiguous buffer.
+** Frames are move-only so a hand-off never deep-copies by accident.
+*/
+struct Frame {
+    PixelFormat format;
+    int width;
+    int height;
+    size_t stride;
+    int64_t timestamp;
+    uint64_t sequence;
+    std::vector<uint8_t> data;
+    std::shared_ptr<const FrameFormat> streamFormat;
+
+    Frame() :
+        format(PixelFormat::Unknown),
+        width(0),
+        height(0),
+        stride(0),
+        timestamp(0),
+        sequence(0) {}
+    Frame(Frame&&) = default;
+    Frame& operator=(Frame&&) = default;
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    /*
+    ** Set the layout and size the buffer, keeping the allocation when it
+    ** is already large enough.
+    */
+    void reset(
+        PixelFormat pixelFormat,
+        int w,
+        int h,
+        size_t rowStride,
+        int64_t time = 0
+    ) {
+        format = pixelFormat;
+        width = w;
+        height = h;
+        stride = rowStride;
+        timestamp = time;
+        data.resize(frameBufferSize(pixelFormat, rowStride, h));
+    }
+    void reset(
+        const std::shared_ptr<const FrameFormat>& negotiated,
+        int64_t time
+    ) {
+        streamFormat = negotiated;
+        reset(negotiated->pixelFormat, negotiated->width, negotiated->height, negotiated->stride, time);
+    }
+
+    bool empty() const {
+        return data.empty() || width <= 0 || height <= 0;
+    }
+    const uint8_t* row(int y) const {
+        return data.data() + y * stride;
+    }
+    uint8_t* row(int y) {
+        return data.data() + y * stride;
+    }
+
+    FrameView view() const {
+        FrameView v;
+        v.format = format;
+        v.width = width;
+        v.height = height;
+        v.stride = stride;
+        v.timestamp = timestamp;
+        v.sequence = sequence;
+        v.data = data.data();
+        v.streamFormat = streamFormat.get();
+        return v;
+    }
+    PlaneView lumaPlane() const {
+        return view().lumaPlane();
+    }
+    PlaneView chromaPlane() const {
+        return view().chromaPlane();
+    }
+};
@@ -1,82 +1,133 @@
 #include "frame_converter.h"
+#include <algorithm>
 #include <vector>
+#include <cstring>
 #include <iostream>
-#include <mfapi.h>
-#include <mfidl.h>
-#include <mfreadwrite.h>
+#include "../kernels/integral_kernels.h"
+#include "../runtime/thread_pool.h"
 
-std::vector<std::vector<unsigned char>> FrameConverter::convertToGrayscale(
-    BYTE* pData,
-    DWORD length,
-    IMFSourceReader* pReader
-) { 
-    if(!pData || length == 0) {
-        std::wcout << L"Invalid frame data in convertFrameToGrayscale" << std::endl;
-        return std::vector<std::vector<unsigned char>>();
-    }
+FrameConverter::FrameConverter(
+    ThreadPool* pool,
+    size_t parallelMinPixels
+) :
+    threadPool(pool),
+    parallelMinPixels(parallelMinPixels),
+    shortFrames(0) {}
 
-    IMFMediaType* pType = nullptr;
-    UINT32 width = 0;
-    UINT32 height = 0;
-    GUID subtype = GUID_NULL;
+void FrameConverter::setThreadPool(
+    ThreadPool* pool,
+    size_t parallelMinPixels
+) {
+    threadPool = pool;
+    this->parallelMinPixels = parallelMinPixels;
+}
 
-    HRESULT hr = pReader->GetCurrentMediaType(
-        MF_SOURCE_READER_FIRST_VIDEO_STREAM,
-        &pType
-    );
-    if(SUCCEEDED(hr) && pType) {
-        hr = MFGetAttributeSize(pType, MF_MT_FRAME_SIZE, &width, &height);
-        pType->GetGUID(MF_MT_SUBTYPE, &subtype);
-        pType->Release();
-    }
-    
-    if(width == 0 || height == 0) {
-        width = 640;
-        height = 480;
-        std::wcout << L"Using default resolution for grayscale: " 
-            << width << L"x" << height << std::endl;
+/*
+** Switch-over between the single-threaded and tiled paths
+*/
+ThreadPool* FrameConverter::poolFor(const FrameView& frame) const {
+    if(!threadPool || threadPool->size() < 2) return nullptr;
+    size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+    return pixels >= parallelMinPixels ? threadPool : nullptr;
+}
+
+/*
+** Copy Frame
+*/
+bool FrameConverter::copyFrame(
+    const uint8_t* data,
+    size_t length,
+    const std::shared_ptr<const FrameFormat>& format,
+    int64_t timestamp,
+    Frame& frame
+) {
+    if(!data || length == 0 || !format || !format->valid()) {
+        std::wcout << L"Invalid frame data in copyFrame" << std::endl;
+        return false;
     }
-    
-    std::vector<std::vector<unsigned char>> grayscaleFrame(
-        height,
-        std::vector<unsigned char>(width, 0)
-    );
-    
-    if(subtype == MFVideoFormat_RGB32) {
-        for (UINT32 y = 0; y < height; y++) {
-            for (UINT32 x = 0; x < width; x++) {
-                DWORD pixelOffset = (y * width + x) * 4;
-                if(pixelOffset + 3 < length) {
-                    BYTE b = pData[pixelOffset];
-                    BYTE g = pData[pixelOffset + 1];
-                    BYTE r = pData[pixelOffset + 2];
 
-                    unsigned char gray = static_cast<unsigned char>(
-                        0.299f * r + 0.587f * g + 0.114f * b
-                    );
-                    grayscaleFrame[y][x] = gray;
-                }
-            }
+    // A short buffer is dropped whole: cutting rows off would leave the
+    // frame disagreeing with its format, and NV12 would lose its chroma
+    size_t size = format->bufferSize();
+    if(length < size) {
+        if(shortFrames.fetch_add(1, std::memory_order_relaxed) == 0) {
+            std::wcout << L"Short frame buffer: " << length << L" of " << size
+                       << L" bytes, dropping short frames" << std::endl;
         }
-    } else if(subtype == MFVideoFormat_YUY2) {
-        for (UINT32 y = 0; y < height; y++) {
-            for (UINT32 x = 0; x < width; x += 2) {
-                DWORD pixelOffset = (y * width + x) * 2;
-                if(pixelOffset + 3 < length) {
-                    BYTE y0 = pData[pixelOffset];
-                    BYTE y1 = pData[pixelOffset + 2];
-                    
-                    grayscaleFrame[y][x] = y0;
-                    if(x + 1 < width) {
-                        grayscaleFrame[y][x + 1] = y1;
-                    }
-                }
+        return false;
+    }
+
+    frame.reset(format, timestamp);
+    std::memcpy(frame.data.data(), data, size);
+    return true;
+}
+
+/*
+** Convert to Grayscale
+*/
+bool FrameConverter::convertToGrayscale(const FrameView& frame, Frame& gray) {
+    if(frame.empty()) return false;
+
+    PlaneView luma = frame.lumaPlane();
+    if(luma.empty() && frame.format != PixelFormat::YUY2 && frame.format != PixelFormat::RGB32) {
+        std::wcout << L"Unsupported pixel format in convertToGrayscale" << std::endl;
+        return false;
+    }
+    gray.reset(PixelFormat::Gray8, frame.width, frame.height, frame.width, frame.timestamp);
+
+    auto convertRows = [&](int begin, int end) {
+        int rows = end - begin;
+        uint8_t* dst = gray.row(begin);
+        const uint8_t* src = frame.data + begin * frame.stride;
+        if(!luma.empty()) {
+            for(int y = begin; y < end; y++) {
+                std::memcpy(gray.row(y), luma.row(y), frame.width);
             }
+        } else if(frame.format == PixelFormat::YUY2) {
+            IntegralKernels::grayFromYUY2(src, frame.stride, dst, gray.stride, frame.width, rows);
+        } else {
+            IntegralKernels::grayFromBGRA(src, frame.stride, dst, gray.stride, frame.width, rows);
         }
-    } else {
-        std::wcout << L"Unsupported pixel format in convertFrameToGrayscale" << std::endl;
-        return std::vector<std::vector<unsigned char>>();
+    };
+
+    ThreadPool* pool = poolFor(frame);
+    if(!pool) {
+        convertRows(0, frame.height);
+        return true;
+    }
+
+    size_t tileRows = (frame.height + pool->size() * 2 - 1) / (pool->size() * 2);
+    pool->parallelFor(0, frame.height, tileRows, [&](size_t begin, size_t end) {
+        convertRows(static_cast<int>(begin), static_cast<int>(end));
+    });
+    return true;
+}
+
+/*
+** Convert to Integral
+*/
+bool FrameConverter::convertToIntegral(
+    const FrameView& frame,
+    IntegralImage& integral,
+    bool squared,
+    int decimation
+) {
+    if(frame.empty()) return false;
+    ThreadPool* pool = poolFor(frame);
+
+    switch(frame.format) {
+        case PixelFormat::YUY2:
+            IntegralKernels::fromYUY2(frame.data, frame.stride, frame.width, frame.height, integral, squared, decimation, pool);
+            return true;
+        case PixelFormat::RGB32:
+            IntegralKernels::fromBGRA(frame.data, frame.stride, frame.width, frame.height, integral, squared, decimation, pool);
+            return true;
+        case PixelFormat::Gray8:
+        case PixelFormat::NV12:
+            IntegralKernels::fromPlane(frame.lumaPlane(), integral, squared, decimation, pool);
+            return true;
+        default:
+            std::wcout << L"Unsupported pixel format in convertToIntegral" << std::endl;
+            return false;
     }
-    
-    return grayscaleFrame;
-}
\ No newline at end of file
+}
@@ -1,15 +1,63 @@
 #pragma once
-#include <Windows.h>
-#include <vector>
-#include <iostream>
-#include <mfidl.h>
-#include <mfreadwrite.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "frame.h"
+#include "../classifier/integral_image.h"
 
+class ThreadPool;
+
+/*
+** Pure conversions between frame layouts. Everything a conversion needs
+** comes from the FrameFormat attached to the frame, so nothing here
+** touches the capture API.
+**
+** With a pool, frames of at least parallelMinPixels are split into row
+** tiles. Below that the fork/join costs more than it saves and the
+** conversion stays on the calling thread.
+**
+** copyFrame drops buffers shorter than their format and counts them;
+** only the first is logged, the count is for whoever reports stats.
+*/
 class FrameConverter {
     public:
-        std::vector<std::vector<unsigned char>> convertToGrayscale(
-            BYTE* pData, 
-            DWORD length,
-            IMFSourceReader* pReader
+        // 1920x1080 and up; 720p luma + integral is ~0.4ms single-threaded
+        static const size_t PARALLEL_MIN_PIXELS = 1920 * 1080;
+
+        explicit FrameConverter(
+            ThreadPool* pool = nullptr,
+            size_t parallelMinPixels = PARALLEL_MIN_PIXELS
+        );
+
+        void setThreadPool(
+            ThreadPool* pool,
+            size_t parallelMinPixels = PARALLEL_MIN_PIXELS
+        );
+
+        bool copyFrame(
+            const uint8_t* data,
+            size_t length,
+            const std::shared_ptr<const FrameFormat>& format,
+            int64_t timestamp,
+            Frame& frame
+        );
+        uint64_t droppedShortFrames() const {
+            return shortFrames.load(std::memory_order_relaxed);
+        }
+
+        bool convertToGrayscale(const FrameView& frame, Frame& gray);
+        bool convertToIntegral(
+            const FrameView& frame,
+            IntegralImage& integral,
+            bool squared,
+            int decimation = 1
         );
-};
\ No newline at end of file
+
+    private:
+        ThreadPool* threadPool;
+        size_t parallelMinPixels;
+        std::atomic<uint64_t> shortFrames;
+
+        ThreadPool* poolFor(const FrameView& frame) const;
+};
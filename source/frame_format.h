@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+enum class PixelFormat {
+    Unknown,
+    Gray8,
+    YUY2,
+    RGB32,
+    NV12
+};
+
+inline const wchar_t* pixelFormatName(PixelFormat format) {
+    switch(format) {
+        case PixelFormat::Gray8: return L"Gray8";
+        case PixelFormat::YUY2: return L"YUY2";
+        case PixelFormat::RGB32: return L"RGB32";
+        case PixelFormat::NV12: return L"NV12";
+        default: return L"Unknown";
+    }
+}
+
+/*
+** Bytes per pixel of the first plane. For NV12 that is the Y plane,
+** followed by a half-height plane of interleaved U/V pairs.
+*/
+inline int pixelFormatBytes(PixelFormat format) {
+    switch(format) {
+        case PixelFormat::Gray8: return 1;
+        case PixelFormat::NV12: return 1;
+        case PixelFormat::YUY2: return 2;
+        case PixelFormat::RGB32: return 4;
+        default: return 0;
+    }
+}
+
+inline size_t frameBufferSize(
+    PixelFormat format,
+    size_t stride,
+    int height
+) {
+    size_t size = stride * height;
+    if(format == PixelFormat::NV12) size += stride * ((height + 1) / 2);
+    return size;
+}
+
+/*
+** Stream format as negotiated with the source. It is built once when
+** the reader is configured, rebuilt only when the source reports a
+** format change, and shared read-only by every frame captured under it.
+*/
+struct FrameFormat {
+    PixelFormat pixelFormat;
+    int width;
+    int height;
+    size_t stride;
+    int fpsNumerator;
+    int fpsDenominator;
+    // Bumped on every renegotiation so consumers can spot a change cheaply
+    uint32_t revision;
+
+    FrameFormat() :
+        pixelFormat(PixelFormat::Unknown),
+        width(0),
+        height(0),
+        stride(0),
+        fpsNumerator(0),
+        fpsDenominator(1),
+        revision(0) {}
+
+    bool valid() const {
+        return pixelFormat != PixelFormat::Unknown && width > 0 && height > 0 && stride > 0;
+    }
+    size_t bufferSize() const {
+        return frameBufferSize(pixelFormat, stride, height);
+    }
+    double fps() const {
+        return fpsDenominator > 0 ? static_cast<double>(fpsNumerator) / fpsDenominator : 0.0;
+    }
+};
+
+/*
+** One mode a capture device offers, before anything is negotiated.
+** `index` is the device's own number for it, the native media type
+** index under Media Foundation.
+*/
+struct CaptureMode {
+    PixelFormat pixelFormat;
+    int width;
+    int height;
+    double fps;
+    uint32_t index;
+
+    CaptureMode() :
+        pixelFormat(PixelFormat::Unknown),
+        width(0),
+        height(0),
+        fps(0.0),
+        index(0) {}
+
+    double megapixels() const {
+        return static_cast<double>(width) * height / 1e6;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include "frame_pool.h"
+
+/*
+** Single-producer/single-consumer triple buffer of frames. The producer
+** always overwrites the newest slot and the consumer always takes the
+** freshest frame, so a slow consumer never works on a backlog. A frame
+** replaced before it was taken counts as a drop and is handed back to
+** the producer, so whatever travels with it (a completion, a pool slot)
+** can be let go properly.
+**
+** A slot is a FrameHandle, or anything that carries one; an empty slot
+** is a default-constructed one. publish() and take() are lock-free.
+*/
+template<typename Slot = FrameHandle>
+class FrameMailbox {
+    public:
+        FrameMailbox() :
+            middle(1),
+            back(0),
+            front(2),
+            publishedCount(0),
+            droppedCount(0) {}
+
+        FrameMailbox(const FrameMailbox&) = delete;
+        FrameMailbox& operator=(const FrameMailbox&) = delete;
+
+        /*
+        ** Producer
+        **
+        ** Returns the frame this one replaced, still untaken, or an
+        ** empty slot when the consumer had already taken the last one.
+        */
+        Slot publish(Slot frame) {
+            slots[back] = std::move(frame);
+            uint8_t previous = middle.exchange(back | NEW_FRAME, std::memory_order_acq_rel);
+            back = previous & INDEX_MASK;
+            publishedCount.fetch_add(1, std::memory_order_relaxed);
+
+            // The slot we got back is either a frame nobody took or already empty
+            Slot replaced = std::move(slots[back]);
+            slots[back] = Slot();
+            if(!(previous & NEW_FRAME)) return Slot();
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return replaced;
+        }
+
+        /*
+        ** Consumer
+        */
+        Slot take() {
+            if(!hasNew()) return Slot();
+            uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX_MASK;
+            Slot taken = std::move(slots[front]);
+            slots[front] = Slot();
+            return taken;
+        }
+
+        bool hasNew() const {
+            return (middle.load(std::memory_order_acquire) & NEW_FRAME) != 0;
+        }
+
+        uint64_t published() const {
+            return publishedCount.load(std::memory_order_relaxed);
+        }
+        uint64_t dropped() const {
+            return droppedCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static const uint8_t INDEX_MASK = 0x3;
+        static const uint8_t NEW_FRAME = 0x4;
+
+        Slot slots[3];
+        // Index of the shared middle slot, plus NEW_FRAME when it is unread
+        std::atomic<uint8_t> middle;
+        uint8_t back;
+        uint8_t front;
+
+        std::atomic<uint64_t> publishedCount;
+        std::atomic<uint64_t> droppedCount;
+};
@@ -0,0 +1,58 @@
+#include "frame_pool.h"
+#include <iostream>
+
+void FrameHandle::reset() {
+    if(!slot) return;
+    if(slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        slot->pool->recycle(slot);
+    }
+    slot = nullptr;
+}
+
+FramePool::FramePool(size_t capacity) :
+    acquired(0),
+    exhausted(0)
+{
+    for(size_t i = 0; i < capacity; i++) {
+        slots.push_back(std::make_unique<FrameSlot>(this));
+        freeSlots.push_back(slots.back().get());
+    }
+}
+
+/*
+** Acquire
+*/
+FrameHandle FramePool::acquire() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if(freeSlots.empty()) {
+        exhausted++;
+        return FrameHandle();
+    }
+
+    FrameSlot* slot = freeSlots.back();
+    freeSlots.pop_back();
+    slot->refs.store(1, std::memory_order_relaxed);
+    acquired++;
+    return FrameHandle(slot);
+}
+
+void FramePool::recycle(FrameSlot* slot) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    freeSlots.push_back(slot);
+}
+
+FramePool::Stats FramePool::stats() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    Stats s;
+    s.capacity = slots.size();
+    s.inUse = slots.size() - freeSlots.size();
+    s.acquired = acquired;
+    s.exhausted = exhausted;
+    return s;
+}
+
+void FramePool::logStats() const {
+    Stats s = stats();
+    std::wcout << L"Frame pool: " << s.acquired << L" frames, " << s.exhausted
+               << L" dropped with all " << s.capacity << L" buffers in use" << std::endl;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "frame.h"
+
+class FramePool;
+
+/*
+** One pooled buffer. The reference count lives in the slot itself, so
+** handing a frame to another stage is an atomic increment, not a copy
+** and not an allocation.
+*/
+struct FrameSlot {
+    Frame frame;
+    std::atomic<int> refs;
+    FramePool* pool;
+
+    FrameSlot(FramePool* owner) :
+        refs(0),
+        pool(owner) {}
+};
+
+/*
+** Counted handle to a pooled frame. The last handle to go away returns
+** the buffer to its pool. Only the sole owner may write to the frame,
+** which is the capture side between acquire() and publishing.
+*/
+class FrameHandle {
+    public:
+        FrameHandle() :
+            slot(nullptr) {}
+        explicit FrameHandle(FrameSlot* slot) :
+            slot(slot) {}
+        FrameHandle(const FrameHandle& other) :
+            slot(other.slot) {
+            if(slot) slot->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        FrameHandle(FrameHandle&& other) noexcept :
+            slot(other.slot) {
+            other.slot = nullptr;
+        }
+        FrameHandle& operator=(FrameHandle other) noexcept {
+            std::swap(slot, other.slot);
+            return *this;
+        }
+        ~FrameHandle() {
+            reset();
+        }
+
+        void reset();
+
+        explicit operator bool() const {
+            return slot != nullptr;
+        }
+        const Frame& operator*() const {
+            return slot->frame;
+        }
+        const Frame* operator->() const {
+            return &slot->frame;
+        }
+        Frame& writable() {
+            return slot->frame;
+        }
+        FrameView view() const {
+            return slot ? slot->frame.view() : FrameView();
+        }
+
+    private:
+        FrameSlot* slot;
+};
+
+/*
+** Fixed number of frame buffers shared by capture and its consumers.
+** Buffers keep their allocation across uses, so after warm-up a frame
+** costs no heap allocation. When every buffer is still referenced the
+** acquire fails and the exhaustion counter goes up.
+*/
+class FramePool {
+    public:
+        struct Stats {
+            size_t capacity;
+            size_t inUse;
+            uint64_t acquired;
+            uint64_t exhausted;
+        };
+
+        explicit FramePool(size_t capacity = 8);
+
+        FrameHandle acquire();
+        Stats stats() const;
+        void logStats() const;
+
+    private:
+        friend class FrameHandle;
+
+        std::vector<std::unique_ptr<FrameSlot>> slots;
+        std::vector<FrameSlot*> freeSlots;
+        mutable std::mutex poolMutex;
+        uint64_t acquired;
+        uint64_t exhausted;
+
+        void recycle(FrameSlot* slot);
+};
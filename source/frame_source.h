@@ -0,0 +1,30 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "frame.h"
+#include "frame_format.h"
+
+/*
+** Anything that produces frames: a camera, a file, a generator.
+** Sources are pulled, readFrame() blocks until the next frame has been
+** copied into the caller's buffer, so a source needs no thread of its
+** own and the caller decides what runs where.
+*/
+class IFrameSource {
+    public:
+        virtual ~IFrameSource() = default;
+
+        virtual std::wstring getName() const = 0;
+
+        // Live sources run at their own rate and drop what is not taken in time
+        virtual bool isLive() const = 0;
+
+        virtual bool open() = 0;
+        virtual void close() = 0;
+
+        // False at the end of the stream or on a read error
+        virtual bool readFrame(Frame& frame) = 0;
+
+        // Format of the most recent frame; null before open()
+        virtual std::shared_ptr<const FrameFormat> getFormat() const = 0;
+};
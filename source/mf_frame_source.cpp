@@ -0,0 +1,137 @@
+#include "mf_frame_source.h"
+#include <iostream>
+
+MediaFoundationSource::MediaFoundationSource(
+    IMFActivate* activate,
+    const std::wstring& name,
+    UINT32 width,
+    UINT32 height
+) :
+    activate(activate),
+    name(name),
+    width(width),
+    height(height),
+    pMediaSource(nullptr),
+    formatRevision(0),
+    started(false)
+{
+    if(activate) activate->AddRef();
+}
+
+MediaFoundationSource::~MediaFoundationSource() {
+    close();
+    if(activate) {
+        activate->Release();
+        activate = nullptr;
+    }
+}
+
+bool MediaFoundationSource::open() {
+    close();
+    if(!activate) {
+        std::wcout << L"No device to open" << std::endl;
+        return false;
+    }
+
+    HRESULT hr = MFStartup(MF_VERSION);
+    if(FAILED(hr)) {
+        std::wcout << L"MFStartup failed: " << hr << std::endl;
+        return false;
+    }
+    started = true;
+
+    hr = activate->ActivateObject(IID_PPV_ARGS(&pMediaSource));
+    if(FAILED(hr)) {
+        std::wcout << L"Failed to activate " << name << L": " << hr << std::endl;
+        close();
+        return false;
+    }
+    if(!sourceReader.createSourceReaderWithRes(nullptr, pMediaSource, width, height)) {
+        close();
+        return false;
+    }
+
+    streamFormat = sourceReader.readCurrentFormat(++formatRevision);
+    if(!streamFormat) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MediaFoundationSource::close() {
+    if(uint64_t shortFrames = frameConverter.droppedShortFrames()) {
+        std::wcout << L"Short capture buffers dropped: " << shortFrames << std::endl;
+    }
+    if(sourceReader.pReader) {
+        sourceReader.pReader->Release();
+        sourceReader.pReader = nullptr;
+    }
+    if(pMediaSource) {
+        pMediaSource->Shutdown();
+        pMediaSource->Release();
+        pMediaSource = nullptr;
+    }
+    if(activate) activate->ShutdownObject();
+    if(started) {
+        MFShutdown();
+        started = false;
+    }
+}
+
+/*
+** Read Frame
+*/
+bool MediaFoundationSource::readFrame(Frame& frame) {
+    if(!sourceReader.pReader) return false;
+
+    for(;;) {
+        DWORD streamIndex = 0;
+        DWORD flags = 0;
+        LONGLONG timestamp = 0;
+        IMFSample* pSample = nullptr;
+        HRESULT hr = sourceReader.pReader->ReadSample(
+            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+            0,
+            &streamIndex,
+            &flags,
+            &timestamp,
+            &pSample
+        );
+        if(FAILED(hr)) {
+            std::wcout << L"ReadSample failed: " << hr << std::endl;
+            return false;
+        }
+        if(flags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR)) {
+            if(pSample) pSample->Release();
+            std::wcout << L"Capture stream ended" << std::endl;
+            return false;
+        }
+        if(flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) {
+            streamFormat = sourceReader.readCurrentFormat(++formatRevision);
+            if(!streamFormat) {
+                if(pSample) pSample->Release();
+                return false;
+            }
+        }
+        // Stream ticks carry no sample
+        if(!pSample) continue;
+
+        bool copied = false;
+        IMFMediaBuffer* pBuffer = nullptr;
+        hr = pSample->ConvertToContiguousBuffer(&pBuffer);
+        if(SUCCEEDED(hr)) {
+            BYTE* pData = nullptr;
+            DWORD maxLength = 0;
+            DWORD currentLength = 0;
+            hr = pBuffer->Lock(&pData, &maxLength, &currentLength);
+            if(SUCCEEDED(hr)) {
+                copied = frameConverter.copyFrame(pData, currentLength, streamFormat, timestamp, frame);
+                pBuffer->Unlock();
+            }
+            pBuffer->Release();
+        }
+        pSample->Release();
+        if(copied) return true;
+    }
+}
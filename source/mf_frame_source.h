@@ -0,0 +1,53 @@
+#pragma once
+#include <Windows.h>
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <memory>
+#include <string>
+#include "frame_source.h"
+#include "frame_converter.h"
+#include "source_reader.h"
+
+/*
+** A Media Foundation capture device behind IFrameSource. The reader is
+** created synchronously, so readFrame() blocks on ReadSample instead of
+** going through an IMFSourceReaderCallback, and the format is re-read
+** whenever the device reports a change.
+*/
+class MediaFoundationSource : public IFrameSource {
+    public:
+        MediaFoundationSource(
+            IMFActivate* activate,
+            const std::wstring& name,
+            UINT32 width = 1280,
+            UINT32 height = 720
+        );
+        ~MediaFoundationSource();
+
+        std::wstring getName() const override {
+            return name;
+        }
+        bool isLive() const override {
+            return true;
+        }
+
+        bool open() override;
+        void close() override;
+        bool readFrame(Frame& frame) override;
+        std::shared_ptr<const FrameFormat> getFormat() const override {
+            return streamFormat;
+        }
+
+    private:
+        IMFActivate* activate;
+        std::wstring name;
+        UINT32 width;
+        UINT32 height;
+        IMFMediaSource* pMediaSource;
+        SourceReader sourceReader;
+        FrameConverter frameConverter;
+        std::shared_ptr<const FrameFormat> streamFormat;
+        uint32_t formatRevision;
+        bool started;
+};
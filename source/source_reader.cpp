@@ -2,51 +2,16 @@
 #include <iostream>
 #include <mfapi.h>
 #include <mfidl.h>
-#include "../controller/capture_controller.h"
 
-bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSource* pCaptureSource) {
-    if(!pCaptureSource) {
-        std::wcout << L"No capture source available" << std::endl;
-        return false;
-    }
-
-    IMFAttributes* pAttrs = nullptr;
-    HRESULT hr = MFCreateAttributes(&pAttrs, 3);
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to create attributes" << std::endl;
-        return false;
-    }
-
-    hr = pAttrs->SetUINT32(
-        MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING,
-        TRUE
-    );
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to enable video" << std::endl;
-        pAttrs->Release();
-        return false;
-    }
-
-    hr = pAttrs->SetUnknown(
-        MF_SOURCE_READER_ASYNC_CALLBACK,
-        instance
-    );
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to set callback" << std::endl;
-        pAttrs->Release();
-        return false;
+namespace {
+    bool isSupportedSubtype(const GUID& subtype) {
+        return SourceReader::toPixelFormat(subtype) != PixelFormat::Unknown;
     }
+}
 
-    hr = MFCreateSourceReaderFromMediaSource(
-        pCaptureSource,
-        pAttrs,
-        &pReader
-    );
-    pAttrs->Release();
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to create source reader: " << hr << std::endl;
-        return false;
-    }
+bool SourceReader::createSourceReader(IMFSourceReaderCallback* callback, IMFMediaSource* pCaptureSource) {
+    if(!openReader(callback, pCaptureSource)) return false;
+    HRESULT hr = S_OK;
 
     IMFMediaType* pMediaType = nullptr;
     IMFMediaType* pHighestResolutionType = nullptr;
@@ -90,7 +55,7 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
         pMediaType->Release();
     }
     if(!pHighestResolutionType) {
-        std::wcout << L"No RGB32 using YUY2..." << std::endl;
+        std::wcout << L"No RGB32 using YUY2 or NV12..." << std::endl;
         for (DWORD i = 0; ; i++) {
             hr = pReader->GetNativeMediaType(
                 MF_SOURCE_READER_FIRST_VIDEO_STREAM,
@@ -109,7 +74,7 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
             if(SUCCEEDED(hr)) {
                 GUID subtype = GUID_NULL;
                 pMediaType->GetGUID(MF_MT_SUBTYPE, &subtype);
-                if(subtype == MFVideoFormat_YUY2) {
+                if(subtype == MFVideoFormat_YUY2 || subtype == MFVideoFormat_NV12) {
                     UINT32 pixelCount = width * height;
                     if(pixelCount > highestPixelCount) {
                         highestPixelCount = pixelCount;
@@ -131,7 +96,7 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
         
         std::wcout << L"Setting resolution: " << highestWidth 
                   << L"x" << highestHeight 
-                  << L" Format: " << (finalSubtype == MFVideoFormat_RGB32 ? L"RGB32" : L"YUY2")
+                  << L" Format: " << pixelFormatName(SourceReader::toPixelFormat(finalSubtype))
                   << std::endl;
         
         hr = pReader->SetCurrentMediaType(
@@ -142,7 +107,7 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
         pHighestResolutionType->Release();
         
         if(SUCCEEDED(hr)) {
-            hr = pReader->ReadSample(
+            if(callback) hr = pReader->ReadSample(
                 MF_SOURCE_READER_FIRST_VIDEO_STREAM,
                 0,
                 nullptr,
@@ -171,7 +136,7 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
         }
         pMediaType->Release();
         
-        if(success) {
+        if(success && callback) {
             hr = pReader->ReadSample(
                 MF_SOURCE_READER_FIRST_VIDEO_STREAM,
                 0,
@@ -188,53 +153,13 @@ bool SourceReader::createSourceReader(CaptureController* instance, IMFMediaSourc
 }
 
 bool SourceReader::createSourceReaderWithRes(
-    CaptureController* instance,
+    IMFSourceReaderCallback* callback,
     IMFMediaSource* pCaptureSource, 
     UINT32 width, 
     UINT32 height
 ) {
-    if(!pCaptureSource) {
-        std::wcout << L"No capture source available" << std::endl;
-        return false;
-    }
-
-    IMFAttributes* pAttrs = nullptr;
-    HRESULT hr = MFCreateAttributes(&pAttrs, 3);
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to create attributes" << std::endl;
-        return false;
-    }
-
-    hr = pAttrs->SetUINT32(
-        MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING,
-        TRUE
-    );
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to enable video" << std::endl;
-        pAttrs->Release();
-        return false;
-    }
-
-    hr = pAttrs->SetUnknown(
-        MF_SOURCE_READER_ASYNC_CALLBACK,
-        instance
-    );
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to set callback" << std::endl;
-        pAttrs->Release();
-        return false;
-    }
-
-    hr = MFCreateSourceReaderFromMediaSource(
-        pCaptureSource,
-        pAttrs,
-        &pReader
-    );
-    pAttrs->Release();
-    if(FAILED(hr)) {
-        std::wcout << L"Failed to create source reader: " << hr << std::endl;
-        return false;
-    }
+    if(!openReader(callback, pCaptureSource)) return false;
+    HRESULT hr = S_OK;
 
     bool resolutionSet = false;
     IMFMediaType* pMediaType = nullptr;
@@ -256,11 +181,11 @@ bool SourceReader::createSourceReaderWithRes(
             if(
                 mediaWidth == width && 
                 mediaHeight == height && 
-                (subtype == MFVideoFormat_YUY2 || subtype == MFVideoFormat_RGB32)
+                isSupportedSubtype(subtype)
             ) {
                 
                 std::wcout << L"Found matching resolution: " << width << L"x" << height 
-                          << L" Format: " << (subtype == MFVideoFormat_YUY2 ? L"YUY2" : L"RGB32") << std::endl;
+                          << L" Format: " << pixelFormatName(SourceReader::toPixelFormat(subtype)) << std::endl;
                 
                 hr = pReader->SetCurrentMediaType(
                     MF_SOURCE_READER_FIRST_VIDEO_STREAM,
@@ -298,7 +223,7 @@ bool SourceReader::createSourceReaderWithRes(
             if(
                 SUCCEEDED(MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &mediaWidth, &mediaHeight)) &&
                 SUCCEEDED(pMediaType->GetGUID(MF_MT_SUBTYPE, &subtype)) &&
-                (subtype == MFVideoFormat_YUY2 || subtype == MFVideoFormat_RGB32)
+                isSupportedSubtype(subtype)
             ) {
                 if(mediaWidth * mediaHeight > bestWidth * bestHeight) {
                     if(bestType) bestType->Release();
@@ -326,7 +251,145 @@ bool SourceReader::createSourceReaderWithRes(
         }
     }
 
-    hr = pReader->ReadSample(
+    if(callback) {
+        hr = pReader->ReadSample(
+            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+            0,
+            nullptr,
+            nullptr,
+            nullptr,
+            nullptr
+        );
+    }
+    if(SUCCEEDED(hr) || !callback) {
+        std::wcout << L"Source reader configured successfully!" << std::endl;
+    } else {
+        std::wcout << L"Failed to start reading: " << hr << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+** Open Reader
+*/
+bool SourceReader::openReader(IMFSourceReaderCallback* callback, IMFMediaSource* pCaptureSource) {
+    if(!pCaptureSource) {
+        std::wcout << L"No capture source available" << std::endl;
+        return false;
+    }
+
+    IMFAttributes* pAttrs = nullptr;
+    HRESULT hr = MFCreateAttributes(&pAttrs, 3);
+    if(FAILED(hr)) {
+        std::wcout << L"Failed to create attributes" << std::endl;
+        return false;
+    }
+
+    hr = pAttrs->SetUINT32(
+        MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING,
+        TRUE
+    );
+    if(FAILED(hr)) {
+        std::wcout << L"Failed to enable video" << std::endl;
+        pAttrs->Release();
+        return false;
+    }
+
+    if(callback) {
+        hr = pAttrs->SetUnknown(
+            MF_SOURCE_READER_ASYNC_CALLBACK,
+            callback
+        );
+        if(FAILED(hr)) {
+            std::wcout << L"Failed to set callback" << std::endl;
+            pAttrs->Release();
+            return false;
+        }
+    }
+
+    hr = MFCreateSourceReaderFromMediaSource(
+        pCaptureSource,
+        pAttrs,
+        &pReader
+    );
+    pAttrs->Release();
+    if(FAILED(hr)) {
+        std::wcout << L"Failed to create source reader: " << hr << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+** Capture Modes
+*/
+std::vector<CaptureMode> SourceReader::listModes() {
+    std::vector<CaptureMode> modes;
+    if(!pReader) return modes;
+
+    IMFMediaType* pMediaType = nullptr;
+    for(DWORD i = 0; ; i++) {
+        HRESULT hr = pReader->GetNativeMediaType(
+            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+            i,
+            &pMediaType
+        );
+        if(FAILED(hr)) break;
+
+        UINT32 width = 0;
+        UINT32 height = 0;
+        GUID subtype = GUID_NULL;
+        if(
+            SUCCEEDED(MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &width, &height)) &&
+            SUCCEEDED(pMediaType->GetGUID(MF_MT_SUBTYPE, &subtype)) &&
+            isSupportedSubtype(subtype)
+        ) {
+            UINT32 fpsNumerator = 0;
+            UINT32 fpsDenominator = 1;
+            MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &fpsNumerator, &fpsDenominator);
+
+            CaptureMode mode;
+            mode.pixelFormat = toPixelFormat(subtype);
+            mode.width = static_cast<int>(width);
+            mode.height = static_cast<int>(height);
+            mode.fps = fpsDenominator > 0 ? static_cast<double>(fpsNumerator) / fpsDenominator : 0.0;
+            mode.index = i;
+            modes.push_back(mode);
+        }
+        pMediaType->Release();
+    }
+    return modes;
+}
+
+bool SourceReader::setMode(const CaptureMode& mode) {
+    if(!pReader) return false;
+
+    IMFMediaType* pMediaType = nullptr;
+    HRESULT hr = pReader->GetNativeMediaType(
+        MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+        mode.index,
+        &pMediaType
+    );
+    if(SUCCEEDED(hr)) {
+        hr = pReader->SetCurrentMediaType(
+            MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+            nullptr,
+            pMediaType
+        );
+        pMediaType->Release();
+    }
+    if(FAILED(hr)) {
+        std::wcout << L"Failed to set capture mode " << mode.width << L"x" << mode.height
+                   << L": " << hr << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SourceReader::requestSample() {
+    if(!pReader) return false;
+    HRESULT hr = pReader->ReadSample(
         MF_SOURCE_READER_FIRST_VIDEO_STREAM,
         0,
         nullptr,
@@ -334,11 +397,77 @@ bool SourceReader::createSourceReaderWithRes(
         nullptr,
         nullptr
     );
-    if(SUCCEEDED(hr)) {
-        std::wcout << L"Source reader configured successfully!" << std::endl;
-    } else {
+    if(FAILED(hr)) {
         std::wcout << L"Failed to start reading: " << hr << std::endl;
         return false;
     }
-    return SUCCEEDED(hr);
+    return true;
+}
+
+/*
+** Format Negotiation
+*/
+PixelFormat SourceReader::toPixelFormat(const GUID& subtype) {
+    if(subtype == MFVideoFormat_YUY2) return PixelFormat::YUY2;
+    if(subtype == MFVideoFormat_RGB32) return PixelFormat::RGB32;
+    if(subtype == MFVideoFormat_NV12) return PixelFormat::NV12;
+    return PixelFormat::Unknown;
+}
+
+std::shared_ptr<const FrameFormat> SourceReader::readCurrentFormat(uint32_t revision) {
+    if(!pReader) return nullptr;
+
+    IMFMediaType* pMediaType = nullptr;
+    HRESULT hr = pReader->GetCurrentMediaType(
+        MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+        &pMediaType
+    );
+    if(FAILED(hr) || !pMediaType) {
+        std::wcout << L"Failed to read current media type: " << hr << std::endl;
+        return nullptr;
+    }
+
+    auto format = std::make_shared<FrameFormat>();
+    UINT32 width = 0;
+    UINT32 height = 0;
+    GUID subtype = GUID_NULL;
+    hr = MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &width, &height);
+    if(SUCCEEDED(hr)) hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &subtype);
+
+    UINT32 fpsNumerator = 0;
+    UINT32 fpsDenominator = 1;
+    if(SUCCEEDED(hr)) {
+        MFGetAttributeRatio(pMediaType, MF_MT_FRAME_RATE, &fpsNumerator, &fpsDenominator);
+    }
+
+    // Contiguous buffers are packed at the default stride; bottom-up RGB reports it negative
+    UINT32 defaultStride = 0;
+    if(SUCCEEDED(hr)) pMediaType->GetUINT32(MF_MT_DEFAULT_STRIDE, &defaultStride);
+    pMediaType->Release();
+    if(FAILED(hr)) {
+        std::wcout << L"Incomplete media type: " << hr << std::endl;
+        return nullptr;
+    }
+
+    format->pixelFormat = toPixelFormat(subtype);
+    format->width = static_cast<int>(width);
+    format->height = static_cast<int>(height);
+    format->fpsNumerator = static_cast<int>(fpsNumerator);
+    format->fpsDenominator = static_cast<int>(fpsDenominator);
+    format->revision = revision;
+
+    size_t packedStride = static_cast<size_t>(width) * pixelFormatBytes(format->pixelFormat);
+    int signedStride = static_cast<int>(defaultStride);
+    size_t stride = static_cast<size_t>(signedStride < 0 ? -signedStride : signedStride);
+    format->stride = stride >= packedStride ? stride : packedStride;
+
+    std::wcout << L"Negotiated format " << format->revision << L": "
+               << format->width << L"x" << format->height << L" "
+               << pixelFormatName(format->pixelFormat) << L" stride " << format->stride
+               << L" @ " << format->fps() << L" fps" << std::endl;
+    if(!format->valid()) {
+        std::wcout << L"Negotiated format is not supported" << std::endl;
+        return nullptr;
+    }
+    return format;
 }
@@ -10,20 +10,43 @@
 #include <queue>
 #include <mutex>
 #include <atomic>
+#include <memory>
+#include "frame_format.h"
 
-class CaptureController;
+/*
+** Configures an IMFSourceReader on a capture source. With a callback the
+** reader runs asynchronously and the first ReadSample is issued here;
+** without one it is synchronous and the caller pulls samples itself.
+**
+** openReader() only creates the reader, for callers that pick the mode
+** themselves from listModes() and then call requestSample().
+*/
 class SourceReader {
     public:
         IMFSourceReader* pReader;
 
+        SourceReader() :
+            pReader(nullptr) {}
+
         bool createSourceReader(
-            CaptureController* instance, 
+            IMFSourceReaderCallback* callback, 
             IMFMediaSource* pCaptureSource
         );
         bool createSourceReaderWithRes(
-            CaptureController* instance,
+            IMFSourceReaderCallback* callback,
             IMFMediaSource* pCaptureSource, 
             UINT32 width, 
             UINT32 height
         );
+        bool openReader(
+            IMFSourceReaderCallback* callback,
+            IMFMediaSource* pCaptureSource
+        );
+        // Native types in a format the converter reads
+        std::vector<CaptureMode> listModes();
+        bool setMode(const CaptureMode& mode);
+        bool requestSample();
+
+        static PixelFormat toPixelFormat(const GUID& subtype);
+        std::shared_ptr<const FrameFormat> readCurrentFormat(uint32_t revision);
 };
\ No newline at end of file
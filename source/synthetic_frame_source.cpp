@@ -0,0 +1,146 @@
+#include "synthetic_frame_source.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+SyntheticFrameSource::SyntheticFrameSource(
+    int width,
+    int height,
+    PixelFormat pixelFormat,
+    int fps,
+    uint64_t frameCount
+) :
+    frameCount(frameCount),
+    frameIndex(0)
+{
+    auto built = std::make_shared<FrameFormat>();
+    built->pixelFormat = pixelFormat;
+    built->width = width;
+    built->height = height;
+    built->stride = static_cast<size_t>(pixelFormat == PixelFormat::NV12 ? (width + 1) & ~1 : width) * pixelFormatBytes(pixelFormat);
+    built->fpsNumerator = fps;
+    built->fpsDenominator = 1;
+    format = built;
+}
+
+bool SyntheticFrameSource::open() {
+    if(!format->valid()) {
+        std::wcout << L"Invalid synthetic frame format" << std::endl;
+        return false;
+    }
+
+    // Box-smoothed xorshift noise, so neighbouring pixels correlate like a real scene
+    int width = format->width;
+    int height = format->height;
+    std::vector<uint8_t> noise(static_cast<size_t>(width) * height);
+    uint32_t state = 0x9e3779b9u;
+    for(auto& value : noise) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        value = static_cast<uint8_t>(state >> 24);
+    }
+    texture.resize(noise.size());
+    for(int y = 0; y < height; y++) {
+        for(int x = 0; x < width; x++) {
+            int sum = 0;
+            int count = 0;
+            for(int dy = -2; dy <= 2; dy++) {
+                int sy = y + dy;
+                if(sy < 0 || sy >= height) continue;
+                for(int dx = -2; dx <= 2; dx++) {
+                    int sx = x + dx;
+                    if(sx < 0 || sx >= width) continue;
+                    sum += noise[sy * width + sx];
+                    count++;
+                }
+            }
+            texture[y * width + x] = static_cast<uint8_t>(48 + (sum / count) / 2);
+        }
+    }
+    luma.resize(width);
+    frameIndex = 0;
+
+    std::wcout << L"Synthetic source: " << width << L"x" << height << L" "
+               << pixelFormatName(format->pixelFormat) << L" @ " << format->fps() << L" fps" << std::endl;
+    return true;
+}
+
+/*
+** Face-like blob, 0 outside it
+*/
+uint8_t SyntheticFrameSource::blobAt(int x, int y, int centreX, int centreY, int radius) const {
+    float dx = static_cast<float>(x - centreX) / radius;
+    float dy = static_cast<float>(y - centreY) / (radius * 1.25f);
+    if(dx * dx + dy * dy > 1.0f) return 0;
+
+    bool eye = std::fabs(dy + 0.3f) < 0.12f && std::fabs(std::fabs(dx) - 0.4f) < 0.18f;
+    bool mouth = std::fabs(dy - 0.45f) < 0.07f && std::fabs(dx) < 0.35f;
+    return eye || mouth ? 40 : 200;
+}
+
+/*
+** Read Frame
+*/
+bool SyntheticFrameSource::readFrame(Frame& frame) {
+    if(texture.empty()) return false;
+    if(frameCount > 0 && frameIndex >= frameCount) return false;
+
+    int width = format->width;
+    int height = format->height;
+    int64_t timestamp = static_cast<int64_t>(frameIndex) * 10000000 / (std::max)(format->fpsNumerator, 1);
+    frame.reset(format, timestamp);
+
+    double phase = static_cast<double>(frameIndex) / 60.0;
+    int radius = (std::max)(12, height / 8);
+    int centreX = width / 2 + static_cast<int>(std::sin(phase) * (width / 2 - radius));
+    int centreY = height / 2 + static_cast<int>(std::sin(phase * 1.7) * (height / 2 - radius * 1.25));
+    int scroll = static_cast<int>(frameIndex * 2 % width);
+
+    for(int y = 0; y < height; y++) {
+        const uint8_t* source = texture.data() + y * width;
+        for(int x = 0; x < width; x++) {
+            int sx = x + scroll;
+            luma[x] = source[sx < width ? sx : sx - width];
+        }
+        if(std::abs(y - centreY) <= radius * 5 / 4) {
+            for(int x = (std::max)(0, centreX - radius); x <= (std::min)(width - 1, centreX + radius); x++) {
+                uint8_t value = blobAt(x, y, centreX, centreY, radius);
+                if(value) luma[x] = value;
+            }
+        }
+
+        uint8_t* out = frame.row(y);
+        switch(format->pixelFormat) {
+            case PixelFormat::Gray8:
+            case PixelFormat::NV12:
+                std::memcpy(out, luma.data(), width);
+                break;
+            case PixelFormat::YUY2:
+                for(int x = 0; x < width; x++) {
+                    out[x * 2] = luma[x];
+                    out[x * 2 + 1] = 128;
+                }
+                break;
+            case PixelFormat::RGB32:
+                for(int x = 0; x < width; x++) {
+                    out[x * 4] = luma[x];
+                    out[x * 4 + 1] = luma[x];
+                    out[x * 4 + 2] = luma[x];
+                    out[x * 4 + 3] = 255;
+                }
+                break;
+            default:
+                return false;
+        }
+    }
+    if(format->pixelFormat == PixelFormat::NV12) {
+        uint8_t* chroma = frame.data.data() + format->stride * height;
+        std::memset(chroma, 128, format->stride * ((height + 1) / 2));
+    }
+
+    frameIndex++;
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "frame_source.h"
+
+/*
+** Generated frames for benchmarks and smoke tests. A scrolling noise
+** texture keeps the early cascade stages busy and a drifting face-like
+** blob (bright oval, dark eyes and mouth) gives the later stages some
+** work. The output is a pure function of the frame index, so two runs
+** see the same pixels.
+*/
+class SyntheticFrameSource : public IFrameSource {
+    public:
+        SyntheticFrameSource(
+            int width,
+            int height,
+            PixelFormat pixelFormat = PixelFormat::YUY2,
+            int fps = 30,
+            uint64_t frameCount = 0
+        );
+
+        std::wstring getName() const override {
+            return L"synthetic";
+        }
+        bool isLive() const override {
+            return false;
+        }
+
+        bool open() override;
+        void close() override {}
+        bool readFrame(Frame& frame) override;
+        std::shared_ptr<const FrameFormat> getFormat() const override {
+            return format;
+        }
+
+    private:
+        std::shared_ptr<const FrameFormat> format;
+        // 0 runs forever
+        uint64_t frameCount;
+        uint64_t frameIndex;
+        std::vector<uint8_t> texture;
+        std::vector<uint8_t> luma;
+
+        uint8_t blobAt(int x, int y, int centreX, int centreY, int radius) const;
+};
@@ -0,0 +1,123 @@
+#include <atomic>
+#include <future>
+#include <vector>
+#include "test_check.h"
+#include "../classifier/haar_cascade.h"
+#include "../kernels/integral_kernels.h"
+#include "../runtime/async_detector.h"
+#include "../runtime/thread_pool.h"
+#include "../source/frame_pool.h"
+#include "../source/synthetic_frame_source.h"
+
+namespace {
+    const int WIDTH = 160;
+    const int HEIGHT = 120;
+    const int FRAMES = 24;
+
+    /*
+    ** One stage, one feature: a window whose top half is brighter than
+    ** its bottom half. Enough to accept some windows on the synthetic
+    ** frames, so there are faces to compare.
+    */
+    HaarCascade makeCascade() {
+        Feature feature;
+        feature.type = Feature::TWO_VERTICAL;
+        feature.x = 0;
+        feature.y = 0;
+        feature.width = 24;
+        feature.height = 24;
+        feature.threshold = -2000.0f;
+        feature.leftVal = -1.0f;
+        feature.rightVal = 1.0f;
+        feature.leftRight = false;
+
+        StrongClassifier stage;
+        stage.addClassifier(WeakClassifier(feature, 0.0f, 1.0f));
+        stage.threshold = 0.5f;
+
+        HaarCascade cascade;
+        cascade.addStage(stage);
+        return cascade;
+    }
+
+    std::vector<Rect> detectNow(HaarCascade& cascade, const Frame& frame, const ScanConfig& config) {
+        IntegralImage integral;
+        IntegralKernels::fromGray(frame.data.data(), frame.stride, frame.width, frame.height, integral, false);
+        WindowPlan plan;
+        plan.build(integral.width, integral.height, cascade.baseWidth, config);
+        return cascade.detectFaces(integral, plan);
+    }
+
+    bool sameFaces(const std::vector<Rect>& a, const std::vector<Rect>& b) {
+        if(a.size() != b.size()) return false;
+        for(size_t i = 0; i < a.size(); i++) {
+            if(a[i].x != b[i].x || a[i].y != b[i].y || a[i].width != b[i].width || a[i].height != b[i].height) return false;
+        }
+        return true;
+    }
+}
+
+/*
+** Submits a batch of frames with futures and with callbacks, and checks
+** each result belongs to its own frame: same sequence, timestamp and
+** size, the faces a synchronous detect finds, in submission order.
+*/
+int main() {
+    HaarCascade cascade = makeCascade();
+    ThreadPool pool(3);
+    FramePool frames(FRAMES + 1);
+
+    SyntheticFrameSource source(WIDTH, HEIGHT, PixelFormat::Gray8, 30, FRAMES);
+    CHECK(source.open());
+
+    std::vector<FrameHandle> handles;
+    for(int i = 0; i < FRAMES; i++) {
+        FrameHandle handle = frames.acquire();
+        CHECK(handle);
+        if(!handle) break;
+        CHECK(source.readFrame(handle.writable()));
+        // Gaps, as a producer that dropped frames would leave
+        handle.writable().sequence = 1000 + static_cast<uint64_t>(i) * 3;
+        handles.push_back(handle);
+    }
+
+    AsyncDetector detector(cascade, &pool, 4);
+    std::vector<std::future<PipelineResult>> futures;
+    for(const auto& handle : handles) futures.push_back(detector.submit(handle));
+
+    size_t withFaces = 0;
+    for(size_t i = 0; i < futures.size(); i++) {
+        PipelineResult result = futures[i].get();
+        const Frame& frame = *handles[i];
+        CHECK(result.detected);
+        CHECK(result.sequence == frame.sequence);
+        CHECK(result.timestamp == frame.timestamp);
+        CHECK(result.width == WIDTH && result.height == HEIGHT);
+        CHECK(sameFaces(result.faces, detectNow(cascade, frame, detector.scanConfig)));
+        if(!result.faces.empty()) withFaces++;
+    }
+    CHECK(withFaces > 0);
+
+    // Callbacks run in submission order
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> mismatched(0);
+    for(size_t i = 0; i < handles.size(); i++) {
+        uint64_t expected = handles[i]->sequence;
+        bool taken = detector.submit(handles[i], [&next, &mismatched, &handles, expected](const PipelineResult& result) {
+            size_t index = next.fetch_add(1);
+            if(result.sequence != expected || handles[index]->sequence != expected) mismatched++;
+        });
+        CHECK(taken);
+    }
+    detector.drain();
+    CHECK(next.load() == handles.size());
+    CHECK(mismatched.load() == 0);
+    CHECK(detector.getInFlight() == 0);
+    CHECK(detector.getCompleted() == handles.size() * 2);
+
+    // An empty frame is refused, and its future still completes
+    PipelineResult empty = detector.submit(FrameHandle()).get();
+    CHECK(!empty.detected);
+
+    return testResult(L"async_detector_test");
+}
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <vector>
+#include "test_check.h"
+#include "../runtime/capture_modes.h"
+
+namespace {
+    CaptureMode mode(uint32_t index, int width, int height, PixelFormat format, double fps) {
+        CaptureMode m;
+        m.index = index;
+        m.width = width;
+        m.height = height;
+        m.pixelFormat = format;
+        m.fps = fps;
+        return m;
+    }
+
+    /*
+    ** With the default budget (25 ms per detection, 40 ms per scanned
+    ** megapixel, faces down to a tenth of the height against a 24 pixel
+    ** window) these fall into every tier
+    */
+    std::vector<CaptureMode> offered() {
+        return {
+            mode(0, 160, 120, PixelFormat::YUY2, 30.0),
+            mode(1, 1920, 1080, PixelFormat::NV12, 30.0),
+            mode(2, 640, 480, PixelFormat::YUY2, 30.0),
+            mode(3, 320, 240, PixelFormat::YUY2, 30.0),
+            mode(4, 640, 480, PixelFormat::Unknown, 30.0),
+            mode(5, 1280, 720, PixelFormat::YUY2, 30.0),
+            mode(6, 640, 480, PixelFormat::NV12, 15.0),
+            mode(7, 640, 480, PixelFormat::YUY2, 5.0),
+            mode(8, 640, 480, PixelFormat::NV12, 30.0),
+            mode(9, 320, 240, PixelFormat::YUY2, 30.0)
+        };
+    }
+
+    std::vector<uint32_t> order(const std::vector<RankedCaptureMode>& ranked) {
+        std::vector<uint32_t> indices;
+        for(const auto& entry : ranked) indices.push_back(entry.mode.index);
+        return indices;
+    }
+
+    const RankedCaptureMode* find(const std::vector<RankedCaptureMode>& ranked, uint32_t index) {
+        for(const auto& entry : ranked) {
+            if(entry.mode.index == index) return &entry;
+        }
+        return nullptr;
+    }
+
+    void checkRanking() {
+        CaptureBudget budget;
+        std::vector<RankedCaptureMode> ranked = rankCaptureModes(offered(), budget);
+
+        // Adequate within budget largest first, with the cheaper format, then the higher rate, then the
+        // source's order breaking ties; adequate over budget cheapest first; the rest largest first
+        std::vector<uint32_t> expected = { 8, 6, 2, 3, 9, 5, 1, 7, 0 };
+        CHECK(order(ranked) == expected);
+        CHECK(find(ranked, 4) == nullptr);
+
+        CHECK(find(ranked, 8)->adequate && find(ranked, 8)->withinBudget);
+        CHECK(find(ranked, 5)->adequate && !find(ranked, 5)->withinBudget);
+        // Too slow, and too small for the smallest face
+        CHECK(!find(ranked, 7)->adequate);
+        CHECK(!find(ranked, 0)->adequate);
+        CHECK(find(ranked, 8)->costMs < find(ranked, 2)->costMs);
+
+        // Decimation makes scanning cheaper but the smallest findable face larger
+        CaptureBudget decimated;
+        decimated.decimation = 2;
+        std::vector<RankedCaptureMode> coarse = rankCaptureModes(offered(), decimated);
+        CHECK(find(coarse, 5)->withinBudget);
+        CHECK(!find(coarse, 3)->adequate);
+        CHECK(coarse.front().mode.index == 5);
+
+        CHECK(rankCaptureModes(std::vector<CaptureMode>(), budget).empty());
+    }
+
+    void checkCheaper() {
+        std::vector<RankedCaptureMode> ranked = rankCaptureModes(offered(), CaptureBudget());
+
+        const RankedCaptureMode* cheaper = cheaperCaptureMode(ranked, mode(5, 1280, 720, PixelFormat::YUY2, 30.0));
+        CHECK(cheaper && cheaper->mode.index == 8);
+        cheaper = cheaperCaptureMode(ranked, mode(8, 640, 480, PixelFormat::NV12, 30.0));
+        CHECK(cheaper && cheaper->mode.index == 3);
+        // Only inadequate modes are cheaper than the smallest adequate one
+        CHECK(cheaperCaptureMode(ranked, mode(3, 320, 240, PixelFormat::YUY2, 30.0)) == nullptr);
+        // Not one of the ranked modes
+        CHECK(cheaperCaptureMode(ranked, mode(42, 640, 480, PixelFormat::YUY2, 30.0)) == nullptr);
+    }
+
+    void checkSelector() {
+        typedef CaptureModeSelector::Clock Clock;
+        CaptureModeSelector selector(CaptureModeSelector::Config(CaptureBudget(), 100.0, 0.0));
+
+        CaptureMode chosen;
+        CHECK(!selector.select(std::vector<CaptureMode>(), chosen));
+        CHECK(selector.select(offered(), chosen));
+        CHECK(chosen.index == 8);
+
+        DetectionRateController::Metrics rate = DetectionRateController::Metrics();
+        ScanQualityController::Metrics quality = ScanQualityController::Metrics();
+        rate.detectMs = 60.0;
+        rate.active = false;
+        rate.budgetUsed = 0.5;
+
+        Clock::time_point start = Clock::now() + std::chrono::seconds(1);
+        CaptureMode next;
+        // Within budget, nothing to do
+        CHECK(!selector.report(rate, quality, start, next));
+
+        // Over budget with a still scene: a switch once it has held for holdMs
+        rate.budgetUsed = 2.0;
+        CHECK(!selector.report(rate, quality, start + std::chrono::milliseconds(10), next));
+        CHECK(!selector.report(rate, quality, start + std::chrono::milliseconds(50), next));
+        CHECK(selector.report(rate, quality, start + std::chrono::milliseconds(200), next));
+        CHECK(next.index == 3);
+
+        CaptureModeSelector::Metrics metrics = selector.getMetrics();
+        CHECK(metrics.switches == 1);
+        CHECK(metrics.mode.index == 3);
+        // Recalibrated from the measured 60 ms, well above the 40 ms per megapixel estimate
+        CHECK(metrics.scanMsPerMegapixel > 40.0);
+
+        // Nothing adequate is cheaper than 320x240
+        CHECK(!selector.report(rate, quality, start + std::chrono::milliseconds(300), next));
+        CHECK(!selector.report(rate, quality, start + std::chrono::milliseconds(500), next));
+        CHECK(selector.getMetrics().switches == 1);
+    }
+}
+
+int main() {
+    checkRanking();
+    checkCheaper();
+    checkSelector();
+    return testResult(L"capture_modes_test");
+}
@@ -0,0 +1,173 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "test_check.h"
+#include "../source/file_frame_source.h"
+#include "../source/synthetic_frame_source.h"
+
+namespace {
+    void writeFile(const std::string& name, const std::string& header, const std::vector<uint8_t>& payload) {
+        std::ofstream out(name, std::ios::binary);
+        out << header;
+        out.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+
+    std::vector<uint8_t> counting(size_t size, uint8_t first) {
+        std::vector<uint8_t> bytes(size);
+        for(size_t i = 0; i < size; i++) bytes[i] = static_cast<uint8_t>(first + i);
+        return bytes;
+    }
+
+    /*
+    ** 4:2:0 Y4M at an odd size comes out as NV12, chroma interleaved,
+    ** rows padded to an even stride, and every frame carries the one
+    ** negotiated format
+    */
+    void checkY4M420() {
+        const std::string name = "frame_sources_test_420.y4m";
+        const int width = 5;
+        const int height = 3;
+        // Per frame: 15 luma bytes, then 3x2 U and 3x2 V
+        std::string stream = "YUV4MPEG2 W5 H3 F25:1 Ip C420jpeg\n";
+        for(int f = 0; f < 2; f++) {
+            stream += "FRAME\n";
+            std::vector<uint8_t> luma = counting(width * height, static_cast<uint8_t>(f * 100));
+            std::vector<uint8_t> u = counting(6, 200);
+            std::vector<uint8_t> v = counting(6, 220);
+            stream.append(luma.begin(), luma.end());
+            stream.append(u.begin(), u.end());
+            stream.append(v.begin(), v.end());
+        }
+        writeFile(name, stream, std::vector<uint8_t>());
+
+        FileFrameSource source(name, true);
+        CHECK(source.open());
+        std::shared_ptr<const FrameFormat> format = source.getFormat();
+        CHECK(format && format->pixelFormat == PixelFormat::NV12);
+        CHECK(format && format->width == width && format->height == height && format->stride == 6);
+
+        Frame frame;
+        for(int f = 0; f < 3; f++) {
+            CHECK(source.readFrame(frame));
+            CHECK(frame.streamFormat == format);
+            CHECK(frame.format == PixelFormat::NV12 && frame.stride == 6);
+            // 25 fps in 100 ns units; the third read loops back to the first frame
+            CHECK(frame.timestamp == f * 400000);
+            uint8_t first = static_cast<uint8_t>((f % 2) * 100);
+            CHECK(frame.row(0)[0] == first && frame.row(2)[4] == first + 14);
+            const uint8_t* uv = frame.data.data() + frame.stride * height;
+            CHECK(uv[0] == 200 && uv[1] == 220 && uv[4] == 202 && uv[5] == 222);
+            CHECK(uv[frame.stride] == 203 && uv[frame.stride + 1] == 223);
+        }
+        source.close();
+        std::remove(name.c_str());
+    }
+
+    void checkY4MMono() {
+        const std::string name = "frame_sources_test_mono.y4m";
+        std::string stream = "YUV4MPEG2 W4 H2 Cmono\nFRAME\n";
+        std::vector<uint8_t> luma = counting(8, 10);
+        stream.append(luma.begin(), luma.end());
+        writeFile(name, stream, std::vector<uint8_t>());
+
+        FileFrameSource source(name);
+        CHECK(source.open());
+        Frame frame;
+        CHECK(source.readFrame(frame));
+        CHECK(frame.format == PixelFormat::Gray8 && frame.stride == 4);
+        CHECK(std::vector<uint8_t>(frame.data.begin(), frame.data.end()) == luma);
+        // Not looping
+        CHECK(!source.readFrame(frame));
+        source.close();
+        std::remove(name.c_str());
+    }
+
+    void checkBadY4M() {
+        const std::string name = "frame_sources_test_bad.y4m";
+        writeFile(name, "YUV4MPEG2 W4 H2 C444\nFRAME\n", counting(24, 0));
+        FileFrameSource unsupported(name);
+        CHECK(!unsupported.open());
+
+        writeFile(name, "not a y4m file\n", std::vector<uint8_t>());
+        FileFrameSource garbage(name);
+        CHECK(!garbage.open());
+        std::remove(name.c_str());
+
+        FileFrameSource missing("frame_sources_test_missing.y4m");
+        CHECK(!missing.open());
+    }
+
+    // Raw frames back to back, the last one cut short
+    void checkRaw() {
+        const std::string name = "frame_sources_test.yuy2";
+        FrameFormat raw;
+        raw.pixelFormat = PixelFormat::YUY2;
+        raw.width = 4;
+        raw.height = 2;
+        raw.stride = 8;
+        raw.fpsNumerator = 10;
+        writeFile(name, "", counting(16 * 2 + 5, 0));
+
+        FileFrameSource source(name, raw);
+        CHECK(source.open());
+        Frame frame;
+        CHECK(source.readFrame(frame));
+        CHECK(frame.format == PixelFormat::YUY2 && frame.data[0] == 0 && frame.timestamp == 0);
+        CHECK(source.readFrame(frame));
+        CHECK(frame.data[0] == 16 && frame.timestamp == 1000000);
+        CHECK(!source.readFrame(frame));
+        CHECK(source.getFramesRead() == 2);
+        source.close();
+
+        FrameFormat invalid;
+        FileFrameSource unformatted(name, invalid);
+        CHECK(!unformatted.open());
+        std::remove(name.c_str());
+    }
+
+    /*
+    ** Synthetic frames are a pure function of the index, the same luma
+    ** in every format
+    */
+    void checkSynthetic() {
+        const int width = 33;
+        const int height = 21;
+        SyntheticFrameSource gray(width, height, PixelFormat::Gray8, 30, 3);
+        SyntheticFrameSource again(width, height, PixelFormat::Gray8, 30, 3);
+        SyntheticFrameSource yuy2(width + 1, height, PixelFormat::YUY2, 30, 3);
+        SyntheticFrameSource bgra(width, height, PixelFormat::RGB32, 30, 3);
+        SyntheticFrameSource nv12(width, height, PixelFormat::NV12, 30, 3);
+        CHECK(gray.open() && again.open() && yuy2.open() && bgra.open() && nv12.open());
+
+        Frame a, b, packed, rgb, planar;
+        for(int f = 0; f < 3; f++) {
+            CHECK(gray.readFrame(a) && again.readFrame(b));
+            CHECK(a.data == b.data);
+            CHECK(a.timestamp == b.timestamp && a.timestamp == f * 10000000 / 30);
+            CHECK(a.streamFormat == gray.getFormat());
+
+            CHECK(bgra.readFrame(rgb) && nv12.readFrame(planar));
+            bool same = true;
+            for(int y = 0; y < height; y++) {
+                for(int x = 0; x < width; x++) {
+                    uint8_t luma = a.row(y)[x];
+                    same = same && rgb.row(y)[x * 4] == luma && planar.row(y)[x] == luma;
+                }
+            }
+            CHECK(same);
+            CHECK(yuy2.readFrame(packed));
+            CHECK(packed.format == PixelFormat::YUY2 && packed.width == width + 1);
+        }
+        CHECK(!gray.readFrame(a));
+    }
+}
+
+int main() {
+    checkY4M420();
+    checkY4MMono();
+    checkBadY4M();
+    checkRaw();
+    checkSynthetic();
+    return testResult(L"frame_sources_test");
+}
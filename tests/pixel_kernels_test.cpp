@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "test_check.h"
+#include "../kernels/cpu_features.h"
+#include "../kernels/integral_kernels.h"
+#include "../kernels/pixel_kernels.h"
+
+namespace {
+    // Rows are padded so a kernel writing past its width shows up as a difference
+    const size_t PADDING = 64;
+    const uint8_t GUARD = 0xA5;
+
+    std::mt19937 rng(12345);
+
+    std::vector<uint8_t> randomBytes(size_t size) {
+        std::vector<uint8_t> bytes(size);
+        for(auto& b : bytes) b = static_cast<uint8_t>(rng());
+        return bytes;
+    }
+
+    /*
+    ** Widths around every vector step, plus a few odd frame sizes
+    */
+    std::vector<int> testWidths() {
+        std::vector<int> widths;
+        for(int w = 1; w <= 72; w++) widths.push_back(w);
+        widths.push_back(127);
+        widths.push_back(641);
+        widths.push_back(1279);
+        return widths;
+    }
+
+    typedef void (*ConvertYuy2)(const uint8_t*, size_t, uint8_t*, size_t, int, int);
+    typedef void (*ConvertNv12)(const uint8_t*, size_t, const uint8_t*, size_t, uint8_t*, size_t, int, int);
+    typedef void (*Downscale)(const uint8_t*, size_t, uint8_t*, size_t, int, int);
+    typedef uint32_t (*BlockDiff)(const uint8_t*, size_t, const uint8_t*, size_t, int, int);
+    typedef void (*IntegralRow)(const uint8_t*, const float*, float*, int);
+
+    void checkYuy2(ConvertYuy2 variant) {
+        for(int width : testWidths()) {
+            // YUY2 carries pixels in pairs
+            width += width & 1;
+            int height = 3;
+            size_t srcStride = width * 2 + PADDING;
+            size_t dstStride = width * 4 + PADDING;
+            std::vector<uint8_t> src = randomBytes(srcStride * height);
+            std::vector<uint8_t> expected(dstStride * height, GUARD);
+            std::vector<uint8_t> actual(dstStride * height, GUARD);
+            PixelKernels::yuy2ToBgraScalar(src.data(), srcStride, expected.data(), dstStride, width, height);
+            variant(src.data(), srcStride, actual.data(), dstStride, width, height);
+            CHECK(actual == expected);
+        }
+    }
+
+    void checkNv12(ConvertNv12 variant) {
+        for(int width : testWidths()) {
+            for(int height = 1; height <= 4; height++) {
+                size_t strideY = width + PADDING;
+                size_t strideUV = width + (width & 1) + PADDING;
+                size_t dstStride = width * 4 + PADDING;
+                std::vector<uint8_t> luma = randomBytes(strideY * height);
+                std::vector<uint8_t> chroma = randomBytes(strideUV * ((height + 1) / 2));
+                std::vector<uint8_t> expected(dstStride * height, GUARD);
+                std::vector<uint8_t> actual(dstStride * height, GUARD);
+                PixelKernels::nv12ToBgraScalar(luma.data(), strideY, chroma.data(), strideUV, expected.data(), dstStride, width, height);
+                variant(luma.data(), strideY, chroma.data(), strideUV, actual.data(), dstStride, width, height);
+                CHECK(actual == expected);
+            }
+        }
+    }
+
+    void checkDownscale(Downscale variant) {
+        for(int width : testWidths()) {
+            int height = 3;
+            size_t srcStride = width * 2 + PADDING;
+            size_t dstStride = width + PADDING;
+            std::vector<uint8_t> src = randomBytes(srcStride * height * 2);
+            std::vector<uint8_t> expected(dstStride * height, GUARD);
+            std::vector<uint8_t> actual(dstStride * height, GUARD);
+            PixelKernels::downscale2xScalar(src.data(), srcStride, expected.data(), dstStride, width, height);
+            variant(src.data(), srcStride, actual.data(), dstStride, width, height);
+            CHECK(actual == expected);
+        }
+    }
+
+    void checkBlockDiff(BlockDiff variant) {
+        for(int width : testWidths()) {
+            int height = 5;
+            size_t stride = width + PADDING;
+            std::vector<uint8_t> a = randomBytes(stride * height);
+            std::vector<uint8_t> b = randomBytes(stride * height);
+            CHECK(variant(a.data(), stride, b.data(), stride, width, height) ==
+                PixelKernels::blockDiffScalar(a.data(), stride, b.data(), stride, width, height));
+            // Identical blocks with different padding
+            std::vector<uint8_t> c = a;
+            for(int y = 0; y < height; y++) c[y * stride + width] ^= 0xFF;
+            CHECK(variant(a.data(), stride, c.data(), stride, width, height) == 0);
+        }
+    }
+
+    void checkIntegralRow(IntegralRow variant) {
+        for(int width : testWidths()) {
+            std::vector<uint8_t> luma = randomBytes(width);
+            std::vector<float> above(width);
+            for(auto& value : above) value = static_cast<float>(rng() % 100000);
+            std::vector<float> expected(width + PADDING, -1.0f);
+            std::vector<float> actual(width + PADDING, -1.0f);
+            IntegralKernels::integralRowScalar(luma.data(), above.data(), expected.data(), width);
+            variant(luma.data(), above.data(), actual.data(), width);
+            CHECK(actual == expected);
+        }
+    }
+}
+
+/*
+** Every SIMD variant the CPU can run against its scalar reference, on
+** random input at widths that end mid-vector.
+*/
+int main() {
+    const CpuFeatures& cpu = CpuFeatures::get();
+
+    if(cpu.sse2) {
+        checkYuy2(PixelKernels::yuy2ToBgraSSE2);
+        checkNv12(PixelKernels::nv12ToBgraSSE2);
+        checkDownscale(PixelKernels::downscale2xSSE2);
+        checkBlockDiff(PixelKernels::blockDiffSSE2);
+        checkIntegralRow(IntegralKernels::integralRowSSE2);
+    } else {
+        std::wcout << L"No SSE2, SSE2 variants skipped" << std::endl;
+    }
+    if(cpu.avx2) {
+        checkYuy2(PixelKernels::yuy2ToBgraAVX2);
+        checkNv12(PixelKernels::nv12ToBgraAVX2);
+        checkBlockDiff(PixelKernels::blockDiffAVX2);
+    } else {
+        std::wcout << L"No AVX2, AVX2 variants skipped" << std::endl;
+    }
+
+    return testResult(L"pixel_kernels_test");
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <iostream>
+
+/*
+** Just enough for the headless tests: a failed CHECK prints where it
+** failed and is counted, and each test's main() returns testResult().
+*/
+namespace TestCheck {
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+}
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            TestCheck::failures()++; \
+            std::wcout << L"FAILED " << __FILE__ << L":" << __LINE__ << L": " << #condition << std::endl; \
+        } \
+    } while(0)
+
+inline int testResult(const wchar_t* name) {
+    int failures = TestCheck::failures();
+    std::wcout << name << (failures ? L": FAILED, " : L": passed") ;
+    if(failures) std::wcout << failures << L" check(s)";
+    std::wcout << std::endl;
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "sample_set.h"
+#include "../loader.h"
+#include "../classifier/haar_cascade.h"
+#include "../classifier/integral_image.h"
+#include "../kernels/integral_kernels.h"
+#include "../classifier/window_plan.h"
+
+/*
+** Runs a cascade over a sample set and records, for every weak
+** classifier position, the lowest partial sum seen on any window that
+** passes the whole cascade. Stages can then reject a window as soon as
+** its partial sum falls below that trace.
+*/
+int main(int argc, char** argv) {
+    float margin = 0.0f;
+    if(argc < 4 || (argc > 4 && !parseNumber(argv[4], margin))) {
+        std::wcout << L"Usage: calibrate_cascade <cascade.xml> <sample_dir> <out.trace> [margin]" << std::endl;
+        return 1;
+    }
+    std::string cascadeFile = argv[1];
+    std::string sampleDir = argv[2];
+    std::string traceFile = argv[3];
+
+    HaarCascade cascade;
+    if(!Loader::loadFile(cascadeFile, cascade)) {
+        std::wcout << L"Failed to load cascade" << std::endl;
+        return 1;
+    }
+    SampleSet samples;
+    if(!samples.load(sampleDir)) {
+        std::wcout << L"No samples to calibrate with" << std::endl;
+        return 1;
+    }
+
+    const float unreached = std::numeric_limits<float>::lowest();
+    std::vector<std::vector<float>> traces(cascade.stages.size());
+    for(size_t s = 0; s < cascade.stages.size(); s++) {
+        cascade.stages[s].rejectionTrace.clear();
+        traces[s].assign(cascade.stages[s].weakClassifiers.size(), std::numeric_limits<float>::max());
+    }
+
+    std::vector<float> partials;
+    size_t windows = 0;
+    size_t acceptedWindows = 0;
+
+    for(const auto& sample : samples.samples) {
+        IntegralImage integral;
+        IntegralKernels::fromPlane(sample.image.lumaPlane(), integral, false);
+        if(integral.empty()) continue;
+
+        WindowPlan plan;
+        plan.build(integral.width, integral.height, cascade.baseWidth, ScanConfig());
+
+        std::vector<std::vector<float>> windowPartials(cascade.stages.size());
+        for(const auto& w : plan.windows) {
+            float scale = plan.levels[w.level].scale;
+            bool accepted = true;
+            for(size_t s = 0; s < cascade.stages.size() && accepted; s++) {
+                float sum = cascade.stages[s].evaluate(integral, w.x, w.y, scale, &windowPartials[s]);
+                accepted = sum >= cascade.stages[s].threshold;
+            }
+            windows++;
+            if(!accepted) continue;
+
+            acceptedWindows++;
+            for(size_t s = 0; s < cascade.stages.size(); s++) {
+                for(size_t i = 0; i < windowPartials[s].size(); i++) {
+                    traces[s][i] = (std::min)(traces[s][i], windowPartials[s][i]);
+                }
+            }
+        }
+        std::wcout << L"Calibrated on " << sample.name.c_str() << std::endl;
+    }
+
+    for(size_t s = 0; s < cascade.stages.size(); s++) {
+        for(auto& v : traces[s]) {
+            v = v == std::numeric_limits<float>::max() ? unreached : v - margin;
+        }
+    }
+
+    // Replay the sample set with the traces to measure the saving
+    size_t fullEvaluations = 0;
+    size_t softEvaluations = 0;
+    size_t softWindows = 0;
+    for(const auto& sample : samples.samples) {
+        IntegralImage integral;
+        IntegralKernels::fromPlane(sample.image.lumaPlane(), integral, false);
+        if(integral.empty()) continue;
+
+        WindowPlan plan;
+        plan.build(integral.width, integral.height, cascade.baseWidth, ScanConfig());
+
+        for(const auto& w : plan.windows) {
+            float scale = plan.levels[w.level].scale;
+            bool fullAccepted = true;
+            bool softAccepted = true;
+            for(size_t s = 0; s < cascade.stages.size() && (fullAccepted || softAccepted); s++) {
+                float sum = cascade.stages[s].evaluate(integral, w.x, w.y, scale, &partials);
+                if(fullAccepted) fullEvaluations += partials.size();
+                if(softAccepted) {
+                    size_t used = partials.size();
+                    for(size_t i = 0; i < partials.size(); i++) {
+                        if(partials[i] < traces[s][i]) {
+                            used = i + 1;
+                            softAccepted = false;
+                            break;
+                        }
+                    }
+                    softEvaluations += used;
+                }
+                if(sum < cascade.stages[s].threshold) {
+                    fullAccepted = false;
+                    softAccepted = false;
+                }
+            }
+            if(softAccepted) softWindows++;
+        }
+    }
+
+    for(size_t s = 0; s < cascade.stages.size(); s++) {
+        cascade.stages[s].rejectionTrace = traces[s];
+    }
+
+    if(!Loader::saveRejectionTraces(traceFile, cascade)) return 1;
+
+    double perWindow = windows == 0 ? 1.0 : static_cast<double>(windows);
+    std::wcout << L"=== CALIBRATION REPORT ===" << std::endl;
+    std::wcout << L"Windows evaluated: " << windows << std::endl;
+    std::wcout << L"Weak classifiers per window: " << fullEvaluations / perWindow
+               << L" -> " << softEvaluations / perWindow << std::endl;
+    std::wcout << L"Accepted windows: " << acceptedWindows << L" -> " << softWindows << std::endl;
+    std::wcout << L"Traces written to " << traceFile.c_str() << std::endl;
+    return 0;
+}
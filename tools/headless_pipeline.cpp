@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../loader.h"
+#include "../classifier/haar_cascade.h"
+#include "../kernels/kernel_registry.h"
+#include "../runtime/multi_source_runtime.h"
+#include "../runtime/thread_pool.h"
+#include "../source/file_frame_source.h"
+#include "../source/synthetic_frame_source.h"
+#if defined(_WIN32)
+#include "../device/device_list.h"
+#include "../source/mf_frame_source.h"
+#endif
+
+namespace {
+    bool parseSize(const std::string& text, int& width, int& height) {
+        size_t x = text.find('x');
+        if(x == std::string::npos) return false;
+        width = std::atoi(text.substr(0, x).c_str());
+        height = std::atoi(text.substr(x + 1).c_str());
+        return width > 0 && height > 0;
+    }
+
+    PixelFormat parsePixelFormat(const std::string& text) {
+        if(text == "gray" || text == "gray8") return PixelFormat::Gray8;
+        if(text == "yuy2") return PixelFormat::YUY2;
+        if(text == "rgb32" || text == "bgra") return PixelFormat::RGB32;
+        if(text == "nv12") return PixelFormat::NV12;
+        return PixelFormat::Unknown;
+    }
+
+    /*
+    ** synthetic[:WxH[:format]]
+    ** <file>.y4m
+    ** <file>:WxH:format[:fps]   raw frames
+    ** camera:N | camera:all     Windows only
+    */
+    std::unique_ptr<IFrameSource> createSource(const std::string& spec, uint64_t frames) {
+        if(spec.empty()) return nullptr;
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        for(size_t colon = spec.find(':'); ; colon = spec.find(':', begin)) {
+            parts.push_back(spec.substr(begin, colon - begin));
+            if(colon == std::string::npos) break;
+            begin = colon + 1;
+        }
+
+        if(parts[0] == "synthetic") {
+            int width = 1280;
+            int height = 720;
+            if(parts.size() > 1 && !parseSize(parts[1], width, height)) return nullptr;
+            PixelFormat format = parts.size() > 2 ? parsePixelFormat(parts[2]) : PixelFormat::YUY2;
+            return std::unique_ptr<IFrameSource>(new SyntheticFrameSource(width, height, format, 30, frames));
+        }
+#if defined(_WIN32)
+        if(parts[0] == "camera") {
+            static DeviceList deviceList;
+            size_t index = parts.size() > 1 ? std::atoi(parts[1].c_str()) : 0;
+            if(!deviceList.setCamera() || index >= deviceList.devices.size()) return nullptr;
+            const auto& device = deviceList.devices[index];
+            return std::unique_ptr<IFrameSource>(new MediaFoundationSource(device->getActivate(), device->getName()));
+        }
+#endif
+        if(parts.size() == 1) {
+            return std::unique_ptr<IFrameSource>(new FileFrameSource(parts[0]));
+        }
+
+        FrameFormat raw;
+        if(parts.size() < 3 || !parseSize(parts[1], raw.width, raw.height)) return nullptr;
+        raw.pixelFormat = parsePixelFormat(parts[2]);
+        raw.stride = static_cast<size_t>(raw.width) * pixelFormatBytes(raw.pixelFormat);
+        raw.fpsNumerator = parts.size() > 3 ? std::atoi(parts[3].c_str()) : 30;
+        return std::unique_ptr<IFrameSource>(new FileFrameSource(parts[0], raw));
+    }
+
+    // Comma-separated source specs, each run as its own stream
+    bool createSources(
+        const std::string& specs,
+        uint64_t frames,
+        std::vector<std::unique_ptr<IFrameSource>>& sources
+    ) {
+        size_t begin = 0;
+        for(;;) {
+            size_t comma = specs.find(',', begin);
+            std::string spec = specs.substr(begin, comma - begin);
+#if defined(_WIN32)
+            if(spec == "camera:all") {
+                static DeviceList deviceList;
+                if(!deviceList.setCamera() || deviceList.devices.empty()) return false;
+                for(const auto& device : deviceList.devices) {
+                    sources.emplace_back(new MediaFoundationSource(device->getActivate(), device->getName()));
+                }
+            } else
+#endif
+            {
+                std::unique_ptr<IFrameSource> source = createSource(spec, frames);
+                if(!source) {
+                    std::wcout << L"Bad source: " << std::wstring(spec.begin(), spec.end()) << std::endl;
+                    return false;
+                }
+                sources.push_back(std::move(source));
+            }
+            if(comma == std::string::npos) return true;
+            begin = comma + 1;
+        }
+    }
+}
+
+/*
+** Runs capture -> detect over files, generated frames or cameras with
+** no window, and reports throughput and detection latency. Several
+** sources share one cascade and one pool.
+*/
+int main(int argc, char** argv) {
+    if(argc < 3) {
+        std::wcout << L"Usage: headless_pipeline <cascade.xml> <source>[,<source>...] [frames] [decimation] [threads]" << std::endl;
+        std::wcout << L"  source: synthetic[:WxH[:format]] | <file>.y4m | <file>:WxH:format[:fps] | camera:N | camera:all" << std::endl;
+        return 1;
+    }
+    std::string cascadeFile = argv[1];
+    std::string sourceSpec = argv[2];
+    uint64_t frames = argc > 3 ? std::stoull(argv[3]) : 300;
+    int decimation = argc > 4 ? std::stoi(argv[4]) : 1;
+    size_t threads = argc > 5 ? std::stoul(argv[5]) : 0;
+
+    KernelRegistry::get();
+
+    HaarCascade cascade;
+    if(!Loader::loadFile(cascadeFile, cascade)) {
+        std::wcout << L"Failed to load cascade" << std::endl;
+        return 1;
+    }
+    Loader::loadRejectionTraces(cascadeFile + ".trace", cascade);
+
+    std::vector<std::unique_ptr<IFrameSource>> sources;
+    if(!createSources(sourceSpec, frames, sources)) return 1;
+
+    // threads counts the caller; 0 leaves it to CAMVALLEY_THREADS or the core count
+    if(threads > 0) ThreadPool::configureShared(threads);
+    ThreadPool& pool = ThreadPool::shared();
+
+    MultiSourceRuntime runtime(cascade, &pool);
+    runtime.scanConfig.decimation = decimation;
+    for(auto& source : sources) runtime.addSource(*source);
+
+    std::mutex printMutex;
+    std::vector<size_t> lastCounts(sources.size(), 0);
+    runtime.setResultCallback([&printMutex, &lastCounts](size_t index, const PipelineResult& result) {
+        if(result.faces.size() == lastCounts[index]) return;
+        lastCounts[index] = result.faces.size();
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::wcout << L"[" << index << L"] Frame " << result.sequence << L" @ " << result.timestamp / 10000 << L"ms: "
+                   << result.faces.size() << L" face(s)" << std::endl;
+    });
+
+    if(!runtime.run(frames)) return 1;
+
+    uint64_t processed = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    double elapsed = 0.0;
+    for(size_t i = 0; i < runtime.getSourceCount(); i++) {
+        Pipeline::Stats stats = runtime.getStats(i);
+        processed += stats.framesProcessed;
+        totalMs += stats.totalDetectMs;
+        maxMs = (std::max)(maxMs, stats.maxDetectMs);
+        elapsed = (std::max)(elapsed, stats.elapsedSeconds);
+    }
+    runtime.logStats();
+    std::wcout << L"Detect: " << (processed ? totalMs / processed : 0.0) << L" ms mean, "
+               << maxMs << L" ms max" << std::endl;
+    std::wcout << L"Throughput: " << (elapsed > 0 ? processed / elapsed : 0.0) << L" fps over "
+               << elapsed << L" s, " << runtime.getSourceCount() << L" source(s)" << std::endl;
+    return 0;
+}
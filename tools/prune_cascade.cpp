@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "sample_set.h"
+#include "../loader.h"
+#include "../classifier/haar_cascade.h"
+#include "../classifier/integral_image.h"
+#include "../kernels/integral_kernels.h"
+#include "../kernels/kernel_registry.h"
+#include "../classifier/window_plan.h"
+
+namespace {
+    struct PreparedSample {
+        IntegralImage integral;
+        WindowPlan plan;
+    };
+
+    struct Measurement {
+        double nsPerFrame = 0.0;
+        double agreement = 0.0;
+        size_t detections = 0;
+    };
+
+    size_t weakCount(const HaarCascade& cascade) {
+        size_t count = 0;
+        for(const auto& stage : cascade.stages) {
+            count += stage.weakClassifiers.size();
+        }
+        return count;
+    }
+
+    float overlap(const Rect& a, const Rect& b) {
+        int x1 = (std::max)(a.x, b.x);
+        int y1 = (std::max)(a.y, b.y);
+        int x2 = (std::min)(a.x + a.width, b.x + b.width);
+        int y2 = (std::min)(a.y + a.height, b.y + b.height);
+        if(x2 <= x1 || y2 <= y1) return 0.0f;
+
+        float intersection = static_cast<float>(x2 - x1) * (y2 - y1);
+        float unionArea = static_cast<float>(a.width * a.height + b.width * b.height) - intersection;
+        return intersection / unionArea;
+    }
+
+    /*
+    ** Agreement between two detection sets as 2 * matched / (a + b)
+    */
+    double agreement(const std::vector<Rect>& reference, const std::vector<Rect>& pruned) {
+        if(reference.empty() && pruned.empty()) return 1.0;
+
+        std::vector<bool> used(pruned.size(), false);
+        size_t matched = 0;
+        for(const auto& r : reference) {
+            for(size_t j = 0; j < pruned.size(); j++) {
+                if(!used[j] && overlap(r, pruned[j]) >= 0.5f) {
+                    used[j] = true;
+                    matched++;
+                    break;
+                }
+            }
+        }
+        return 2.0 * matched / (reference.size() + pruned.size());
+    }
+
+    /*
+    ** Measure
+    */
+    Measurement measure(
+        HaarCascade& cascade,
+        std::vector<PreparedSample>& samples,
+        const std::vector<std::vector<Rect>>& reference,
+        std::vector<std::vector<Rect>>* detections,
+        int repeats
+    ) {
+        Measurement m;
+        if(detections) detections->resize(samples.size());
+
+        for(size_t i = 0; i < samples.size(); i++) {
+            double best = 0.0;
+            std::vector<Rect> faces;
+            for(int r = 0; r < repeats; r++) {
+                auto start = std::chrono::steady_clock::now();
+                faces = cascade.detectFaces(samples[i].integral, samples[i].plan);
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start
+                ).count();
+                if(r == 0 || elapsed < best) best = static_cast<double>(elapsed);
+            }
+            m.nsPerFrame += best;
+            m.detections += faces.size();
+            m.agreement += reference.empty() ? 1.0 : agreement(reference[i], faces);
+            if(detections) (*detections)[i] = faces;
+        }
+
+        if(!samples.empty()) {
+            m.nsPerFrame /= samples.size();
+            m.agreement /= samples.size();
+        }
+        return m;
+    }
+
+    /*
+    ** Lowest-value weak classifier, by the spread between its leaf values
+    */
+    bool lowestValueWeak(const HaarCascade& cascade, size_t& stageIndex, size_t& weakIndex) {
+        float lowest = 0.0f;
+        bool found = false;
+        for(size_t s = 0; s < cascade.stages.size(); s++) {
+            const auto& weak = cascade.stages[s].weakClassifiers;
+            if(weak.size() < 2) continue;
+            for(size_t i = 0; i < weak.size(); i++) {
+                float value = std::fabs(weak[i].feature.leftVal - weak[i].feature.rightVal) * weak[i].weight;
+                if(!found || value < lowest) {
+                    lowest = value;
+                    stageIndex = s;
+                    weakIndex = i;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+}
+
+/*
+** Greedily drops trailing stages or the lowest-value weak classifiers
+** until detection over the sample set fits a ns-per-frame budget, and
+** writes the pruned cascade plus a report of every step.
+*/
+int main(int argc, char** argv) {
+    std::string cascadeFile = argc > 1 ? argv[1] : "";
+    std::string sampleDir = argc > 2 ? argv[2] : "";
+    double budget = 0.0;
+    std::string outFile = argc > 4 ? argv[4] : "";
+    double minAgreement = 0.0;
+    int repeats = 3;
+    if(
+        argc < 5 ||
+        !parseNumber(argv[3], budget) || budget <= 0.0 ||
+        (argc > 5 && (!parseNumber(argv[5], minAgreement) || minAgreement < 0.0 || minAgreement > 1.0)) ||
+        (argc > 6 && (!parseNumber(argv[6], repeats) || repeats < 1))
+    ) {
+        std::wcout << L"Usage: prune_cascade <cascade.xml> <sample_dir> <budget_ns_per_frame> <out.xml> [min_agreement] [repeats]" << std::endl;
+        std::wcout << L"  budget_ns_per_frame > 0, min_agreement in [0, 1], repeats >= 1" << std::endl;
+        return 1;
+    }
+
+    // Timings depend on the bound kernels, so report them up front
+    KernelRegistry::get();
+
+    HaarCascade cascade;
+    if(!Loader::loadFile(cascadeFile, cascade)) {
+        std::wcout << L"Failed to load cascade" << std::endl;
+        return 1;
+    }
+    SampleSet sampleSet;
+    if(!sampleSet.load(sampleDir)) {
+        std::wcout << L"No samples to measure with" << std::endl;
+        return 1;
+    }
+
+    std::vector<PreparedSample> samples;
+    for(const auto& sample : sampleSet.samples) {
+        PreparedSample prepared;
+        IntegralKernels::fromPlane(sample.image.lumaPlane(), prepared.integral, false);
+        if(prepared.integral.empty()) continue;
+        prepared.plan.build(
+            prepared.integral.width,
+            prepared.integral.height,
+            cascade.baseWidth,
+            ScanConfig()
+        );
+        samples.push_back(std::move(prepared));
+    }
+
+    std::vector<std::vector<Rect>> reference;
+    Measurement full = measure(cascade, samples, std::vector<std::vector<Rect>>(), &reference, repeats);
+
+    std::ofstream report(outFile + ".report.txt");
+    report << "cascade " << cascadeFile << "\n";
+    report << "samples " << samples.size() << "\n";
+    report << "budget_ns " << budget << "\n";
+    report << "step action stages weak ns_per_frame agreement detections\n";
+    report << "0 full " << cascade.stages.size() << " " << weakCount(cascade) << " "
+           << full.nsPerFrame << " " << full.agreement << " " << full.detections << "\n";
+
+    Measurement current = full;
+    int step = 0;
+    while(current.nsPerFrame > budget) {
+        HaarCascade dropStage = cascade;
+        bool canDropStage = dropStage.stages.size() > 1;
+        if(canDropStage) dropStage.stages.pop_back();
+
+        HaarCascade dropWeak = cascade;
+        size_t stageIndex = 0;
+        size_t weakIndex = 0;
+        bool canDropWeak = lowestValueWeak(dropWeak, stageIndex, weakIndex);
+        if(canDropWeak) {
+            auto& stage = dropWeak.stages[stageIndex];
+            stage.weakClassifiers.erase(stage.weakClassifiers.begin() + weakIndex);
+            stage.rejectionTrace.clear();
+        }
+
+        if(!canDropStage && !canDropWeak) {
+            std::wcout << L"Nothing left to prune, budget not met" << std::endl;
+            break;
+        }
+
+        Measurement stageResult;
+        Measurement weakResult;
+        if(canDropStage) stageResult = measure(dropStage, samples, reference, nullptr, repeats);
+        if(canDropWeak) weakResult = measure(dropWeak, samples, reference, nullptr, repeats);
+
+        bool takeStage = canDropStage && (
+            !canDropWeak ||
+            stageResult.agreement > weakResult.agreement ||
+            (stageResult.agreement == weakResult.agreement && stageResult.nsPerFrame < weakResult.nsPerFrame)
+        );
+        Measurement next = takeStage ? stageResult : weakResult;
+        if(next.agreement < minAgreement) {
+            std::wcout << L"Next step would drop agreement to " << next.agreement
+                       << L", below " << minAgreement << L", stopping" << std::endl;
+            break;
+        }
+
+        cascade = takeStage ? dropStage : dropWeak;
+        current = next;
+        step++;
+        report << step << " " << (takeStage ? "drop_stage" : "drop_weak") << " "
+               << cascade.stages.size() << " " << weakCount(cascade) << " "
+               << current.nsPerFrame << " " << current.agreement << " " << current.detections << "\n";
+        std::wcout << L"Step " << step << L": " << (takeStage ? L"dropped stage" : L"dropped weak classifier")
+                   << L", " << current.nsPerFrame << L" ns/frame, agreement " << current.agreement << std::endl;
+    }
+
+    bool met = current.nsPerFrame <= budget;
+    report << "result " << (met ? "met" : "not_met") << " " << current.nsPerFrame
+           << " ns_per_frame agreement " << current.agreement << "\n";
+
+    if(!Loader::saveFile(outFile, cascade)) return 1;
+    Loader::saveRejectionTraces(outFile + ".trace", cascade);
+
+    std::wcout << L"=== PRUNING REPORT ===" << std::endl;
+    std::wcout << L"Cascade: " << cascade.stages.size() << L" stages, " << weakCount(cascade)
+               << L" weak classifiers" << std::endl;
+    std::wcout << L"Detection time: " << full.nsPerFrame << L" -> " << current.nsPerFrame << L" ns/frame" << std::endl;
+    std::wcout << L"Agreement with full cascade: " << current.agreement << std::endl;
+    std::wcout << L"Budget " << (met ? L"met" : L"not met") << L", report in " << (outFile + ".report.txt").c_str() << std::endl;
+    return met ? 0 : 2;
+}
@@ -0,0 +1,119 @@
+#include "sample_set.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Larger sides are taken for a corrupt header rather than allocated
+    const int MAX_SIDE = 16384;
+
+    bool readToken(std::ifstream& file, std::string& token) {
+        token.clear();
+        char c;
+        while(file.get(c)) {
+            if(c == '#') {
+                std::string comment;
+                std::getline(file, comment);
+                continue;
+            }
+            if(std::isspace(static_cast<unsigned char>(c))) {
+                if(!token.empty()) return true;
+                continue;
+            }
+            token += c;
+        }
+        return !token.empty();
+    }
+}
+
+/*
+** Read Image
+*/
+bool SampleSet::readImage(
+    const std::string& fileName,
+    Frame& image
+) {
+    std::ifstream file(fileName, std::ios::binary);
+    if(!file.is_open()) return false;
+
+    std::string magic;
+    std::string widthToken;
+    std::string heightToken;
+    std::string maxToken;
+    if(
+        !readToken(file, magic) ||
+        !readToken(file, widthToken) ||
+        !readToken(file, heightToken) ||
+        !readToken(file, maxToken)
+    ) {
+        return false;
+    }
+    if(magic != "P5" && magic != "P6") return false;
+
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    if(
+        !parseNumber(widthToken, width) ||
+        !parseNumber(heightToken, height) ||
+        !parseNumber(maxToken, maxValue)
+    ) {
+        return false;
+    }
+    if(width <= 0 || height <= 0 || width > MAX_SIDE || height > MAX_SIDE) return false;
+    if(maxValue <= 0 || maxValue > 255) return false;
+
+    int channels = magic == "P6" ? 3 : 1;
+    std::vector<unsigned char> row(static_cast<size_t>(width) * channels);
+    image.reset(PixelFormat::Gray8, width, height, width);
+    for(int y = 0; y < height; y++) {
+        if(!file.read(reinterpret_cast<char*>(row.data()), row.size())) return false;
+        uint8_t* dst = image.row(y);
+        for(int x = 0; x < width; x++) {
+            if(channels == 1) {
+                dst[x] = row[x];
+            } else {
+                unsigned char r = row[x * 3];
+                unsigned char g = row[x * 3 + 1];
+                unsigned char b = row[x * 3 + 2];
+                dst[x] = static_cast<unsigned char>(0.299f * r + 0.587f * g + 0.114f * b);
+            }
+        }
+    }
+    return true;
+}
+
+/*
+** Load
+*/
+bool SampleSet::load(const std::string& directory) {
+    samples.clear();
+
+    std::error_code err;
+    std::vector<std::filesystem::path> paths;
+    for(const auto& entry : std::filesystem::directory_iterator(directory, err)) {
+        if(!entry.is_regular_file()) continue;
+        std::string ext = entry.path().extension().string();
+        if(ext == ".pgm" || ext == ".ppm") paths.push_back(entry.path());
+    }
+    if(err) {
+        std::wcout << L"Failed to read sample directory: " << directory.c_str() << std::endl;
+        return false;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for(const auto& path : paths) {
+        Sample sample;
+        sample.name = path.filename().string();
+        if(readImage(path.string(), sample.image)) {
+            samples.push_back(std::move(sample));
+        } else {
+            std::wcout << L"Skipping unreadable sample: " << sample.name.c_str() << std::endl;
+        }
+    }
+
+    std::wcout << L"Loaded " << samples.size() << L" samples from " << directory.c_str() << std::endl;
+    return !samples.empty();
+}
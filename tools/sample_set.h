@@ -0,0 +1,41 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../source/frame.h"
+
+/*
+** The whole of `text` as a number, for image headers and command lines
+** of the offline tools. False, with `value` untouched, on anything else.
+*/
+template<typename T>
+bool parseNumber(const std::string& text, T& value) {
+    std::istringstream in(text);
+    T parsed;
+    if(!(in >> parsed) || !(in >> std::ws).eof()) return false;
+    value = parsed;
+    return true;
+}
+
+/*
+** Grayscale sample images loaded from a directory of PGM (P5) or
+** PPM (P6) files, used by the offline cascade tools.
+*/
+class SampleSet {
+    public:
+        struct Sample {
+            std::string name;
+            Frame image;
+        };
+        std::vector<Sample> samples;
+
+        bool load(const std::string& directory);
+        size_t size() const {
+            return samples.size();
+        }
+
+        static bool readImage(
+            const std::string& fileName,
+            Frame& image
+        );
+};
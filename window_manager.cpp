@@ -6,7 +6,8 @@
 WindowManager::WindowManager(): 
     hwnd(nullptr),
     hwndVideo(nullptr),
-    hwndOverlay(nullptr) 
+    hwndOverlay(nullptr),
+    facesVersion(0)
 {
     captureController = new CaptureController(*this);
 }
@@ -156,8 +157,9 @@ LRESULT CALLBACK WindowManager::OverlayWndProc(
                 PAINTSTRUCT ps;
                 HDC hdc = BeginPaint(hwnd, &ps);
 
-                auto faces = pWindow->captureController->getCurrentFaces();
-                pWindow->captureController->getClassifierRenderer().draw(hdc, faces);
+                FaceSnapshot faces;
+                pWindow->captureController->getFaceResults().load(faces);
+                pWindow->captureController->getClassifierRenderer().draw(hdc, faces.toVector());
                 EndPaint(hwnd, &ps);
             }
             return 0;
@@ -301,7 +303,6 @@ LRESULT CALLBACK WindowManager::WindowProc(
     }
     
     if(pWindow) {
-        auto faces = pWindow->captureController->getCurrentFaces();
         switch(msg) {
             case WM_USER + 1:
                 std::wcout << L"Initializing capture controller with window: " << pWindow->hwnd << std::endl;
@@ -330,6 +331,8 @@ LRESULT CALLBACK WindowManager::WindowProc(
                 return 1;
                 
             case WM_UPDATE_FACES:
+                // Posted once per change, so several can be queued for faces already painted
+                if(pWindow->captureController->getFaceResults().version() == pWindow->facesVersion) break;
                 if(pWindow->hwndVideo) {
                     RECT videoRect;
                     if(GetWindowRect(pWindow->hwndVideo, &videoRect)) {
@@ -364,8 +367,9 @@ LRESULT CALLBACK WindowManager::WindowProc(
                     DrawText(hdc, L"Camvalley ULTRA ALPHA BUILD!", -1, &rect, DT_LEFT);
                     
                     RECT faceRect = { 550, 40, 800, 70 };
-                    auto faces = pWindow->captureController->getCurrentFaces();
-                    std::wstring faceText = L"Faces detected: " + std::to_wstring(faces.size());
+                    FaceSnapshot faces;
+                    pWindow->facesVersion = pWindow->captureController->getFaceResults().load(faces);
+                    std::wstring faceText = L"Faces detected: " + std::to_wstring(faces.count);
                     DrawText(hdc, faceText.c_str(), -1, &faceRect, DT_LEFT);
 
                     EndPaint(hwnd, &ps);
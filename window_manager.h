@@ -9,6 +9,7 @@
 #include <mfidl.h>
 #include <string>
 #include <mfreadwrite.h>
+#include <cstdint>
 
 class CaptureController;
 #define WM_UPDATE_FACES (WM_USER + 100)
@@ -20,6 +21,8 @@ class WindowManager {
         HWND hwndVideo;
         HWND hwndOverlay;
         CaptureController* captureController;
+        // Version of the faces last painted, see FaceChannel
+        uint64_t facesVersion;
 
         WindowManager();
         ~WindowManager();